@@ -386,7 +386,35 @@ IRState::convertTo (tree exp, Type *exp_type, Type *target_type)
 	else if (!obj_class_decl->isCOMclass())
 	  use_dynamic = true;
 
-	if (use_dynamic)
+	if (use_dynamic && !obj_class_decl->isInterfaceDeclaration()
+	    && !target_class_decl->isInterfaceDeclaration())
+	  {
+	    // Casting a class down to a class.  The ClassInfo of the object
+	    // is the first entry of its vtbl; if it is the target itself the
+	    // cast succeeds.  If not, a final target can't match any other
+	    // class, otherwise the base classes are walked at runtime.
+	    tree cinfo = addressOf (target_class_decl->toSymbol()->Stree);
+	    exp = maybeMakeTemp (exp);
+
+	    tree obj_rec = indirect (exp);
+	    tree vptr = component (obj_rec, TYPE_FIELDS (TREE_TYPE (obj_rec)));
+	    tree cond = build2 (TRUTH_ANDIF_EXPR, boolean_type_node,
+				boolOp (NE_EXPR, exp, d_null_pointer),
+				boolOp (EQ_EXPR, indirect (ptr_type_node, vptr),
+					convertTo (ptr_type_node, cinfo)));
+
+	    tree t = target_type->toCtype();
+	    tree fail;
+	    if (target_class_decl->storage_class & STCfinal)
+	      fail = nop (t, d_null_pointer);
+	    else
+	      {
+		tree args[2] = { exp, cinfo };
+		fail = nop (t, libCall (LIBCALL_CLASS_CAST, 2, args));
+	      }
+	    return build3 (COND_EXPR, t, cond, nop (t, exp), fail);
+	  }
+	else if (use_dynamic)
 	  {
 	    // Otherwise, do dynamic cast
 	    tree args[2] = {
@@ -1373,6 +1401,15 @@ IRState::objectInstanceMethod (Expression *obj_exp, FuncDeclaration *func, Type
 	    this_expr = addressOf (this_expr);
 	  return methodCallExpr (addressOf (func), this_expr, d_type);
 	}
+
+      // So can methods no class derived from the type of the object
+      // overrides, see ClassDeclaration::devirtualize.
+      FuncDeclaration *target = NULL;
+      if (obj_type->ty == Tclass)
+	target = ((TypeClass *) obj_type)->sym->devirtualize (func);
+
+      if (target)
+	return methodCallExpr (addressOf (target), this_expr, d_type);
       else
 	{
 	  // Interface methods are also in the class's vtable, so we don't
@@ -1397,6 +1434,11 @@ IRState::objectInstanceMethod (Expression *obj_exp, FuncDeclaration *func, Type
 				   size_int (PTRSIZE * func->vtblIndex));
 	  vtbl_ref = indirect (TREE_TYPE (addressOf (func)), vtbl_ref);
 
+	  // Mark the load as a virtual call of slot vtblIndex, so that
+	  // the optimizer may devirtualize it once the object is known.
+	  vtbl_ref = build3 (OBJ_TYPE_REF, TREE_TYPE (vtbl_ref), vtbl_ref,
+			     this_expr, size_int (func->vtblIndex));
+
 	  return methodCallExpr (vtbl_ref, this_expr, d_type);
 	}
     }
@@ -1526,13 +1568,14 @@ IRState::toElemLvalue (Expression *e)
 	  Type *key_type = ((TypeAArray *) array_type)->index->toBasetype();
 	  AddrOfExpr aoe;
 
-	  tree args[4] = {
+	  tree args[5] = {
 	      addressOf (toElemLvalue (e1)),
 	      typeinfoReference (key_type),
 	      integerConstant (array_type->nextOf()->size(), Type::tsize_t),
-	      aoe.set (this, convertTo (e2, key_type))
+	      aoe.set (this, convertTo (e2, key_type)),
+	      aaKeyKind (key_type)
 	  };
-	  tree result = aoe.finish (this, libCall (LIBCALL_AAGETX, 4, args, type->pointerTo()->toCtype()));
+	  tree result = aoe.finish (this, libCall (LIBCALL_AAGETKX, 5, args, type->pointerTo()->toCtype()));
 	  return build1 (INDIRECT_REF, type->toCtype(), result);
 	}
     }
@@ -2479,7 +2522,7 @@ static const char *libcall_ids[LIBCALL_count] = {
     "_aApplywc1", "_aApplywc2", "_aApplywd1", "_aApplywd2",
     "_aaApply", "_aaApply2",
     "_aaDelX", "_aaEqual",
-    "_aaGetRvalueX", "_aaGetX",
+    "_aaGetKX", "_aaGetRvalueX", "_aaGetX",
     "_aaInX", "_aaLen",
     "_adCmp", "_adCmp2",
     "_adDupT", "_adEq", "_adEq2",
@@ -2497,6 +2540,7 @@ static const char *libcall_ids[LIBCALL_count] = {
     "_d_assert", "_d_assert_msg",
     "_d_assocarrayliteralTX",
     "_d_callfinalizer", "_d_callinterfacefinalizer",
+    "_d_class_cast",
     "_d_criticalenter", "_d_criticalexit",
     "_d_delarray", "_d_delarray_t", "_d_delclass",
     "_d_delinterface", "_d_delmemory",
@@ -2643,6 +2687,7 @@ IRState::getLibCallDecl (LibCall libcall)
 	  treturn = Type::tvoid->arrayOf();
 	  break;
 
+	case LIBCALL_CLASS_CAST:
 	case LIBCALL_DYNAMIC_CAST:
 	case LIBCALL_INTERFACE_CAST:
 	  targs.push (getObjectType());
@@ -2687,6 +2732,15 @@ IRState::getLibCallDecl (LibCall libcall)
 	  treturn = Type::tvoidptr;
 	  break;
 
+	case LIBCALL_AAGETKX:
+	  targs.push (aa_type->pointerTo());
+	  targs.push (Type::typeinfo->type->constOf());
+	  targs.push (Type::tsize_t);
+	  targs.push (Type::tvoidptr);
+	  targs.push (Type::tsize_t);
+	  treturn = Type::tvoidptr;
+	  break;
+
 	case LIBCALL_AAGETRVALUEX:
 	  targs.push (aa_type);
 	  targs.push (Type::typeinfo->type->constOf());
@@ -3310,6 +3364,34 @@ IRState::typeinfoReference (Type *t)
   return ti_ref;
 }
 
+// Return the kind of AA key T, telling the runtime how to hash and compare
+// keys without calling TypeInfo.  Must agree with KeyKind in rt/aaA.d.
+
+tree
+IRState::aaKeyKind (Type *t)
+{
+  enum { AAKEY_GENERIC, AAKEY_STRING, AAKEY_INTEGRAL };
+  int kind = AAKEY_GENERIC;
+  Type *tb = t->toBasetype();
+
+  if (tb->ty == Tarray)
+    {
+      Type *tn = tb->nextOf()->toBasetype();
+      if (tn->ty == Tchar || tn->ty == Tint8 || tn->ty == Tuns8)
+	kind = AAKEY_STRING;
+    }
+  else if (tb->ty == Tpointer)
+    kind = AAKEY_INTEGRAL;
+  else if (tb->isintegral())
+    {
+      d_uns64 size = tb->size();
+      if (size == 1 || size == 2 || size == 4 || size == 8)
+	kind = AAKEY_INTEGRAL;
+    }
+
+  return integerConstant (kind, Type::tsize_t);
+}
+
 // Return host integer value for INT_CST T.
 
 dinteger_t
@@ -3972,6 +4054,15 @@ IRState::getFrameInfo (FuncDeclaration *fd)
   if (ffi->creates_frame)
     ffi->frame_rec = buildFrameForFunction (fd);
 
+  if (global.params.vclosures && fd->closureVars.dim != 0)
+    {
+      char *p = fd->loc.toChars();
+      fprintf (stderr, "%s: %s allocates its frame on the %s\n", p ? p : "",
+	       fd->toPrettyChars(), ffi->is_closure ? "heap" : "stack");
+      if (p)
+	free (p);
+    }
+
   return ffi;
 }
 
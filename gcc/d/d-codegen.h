@@ -53,6 +53,7 @@ enum LibCall
   LIBCALL_AAAPPLY2,
   LIBCALL_AADELX,
   LIBCALL_AAEQUAL,
+  LIBCALL_AAGETKX,
   LIBCALL_AAGETRVALUEX,
   LIBCALL_AAGETX,
   LIBCALL_AAINX,
@@ -90,6 +91,7 @@ enum LibCall
   LIBCALL_ASSOCARRAYLITERALTX,
   LIBCALL_CALLFINALIZER,
   LIBCALL_CALLINTERFACEFINALIZER,
+  LIBCALL_CLASS_CAST,
   LIBCALL_CRITICALENTER,
   LIBCALL_CRITICALEXIT,
   LIBCALL_DELARRAY,
@@ -390,6 +392,7 @@ struct IRState : IRBase
   static tree floatMod (tree type, tree arg0, tree arg1);
 
   tree typeinfoReference (Type *t);
+  tree aaKeyKind (Type *t);
 
   dinteger_t getTargetSizeConst (tree t);
 
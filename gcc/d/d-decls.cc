@@ -72,7 +72,7 @@ Dsymbol::toSymbolX (const char *prefix, int, type *, const char *suffix)
   char *id = (char *) alloca (sz);
 
   snprintf (id, sz, "_D%s%zu%s%s", n, strlen (prefix), prefix, suffix);
-  return symbol_calloc (id);
+  return symbol_calloc (shortMangle (id));
 }
 
 
@@ -132,7 +132,7 @@ VarDeclaration::toSymbol (void)
 
       if (isDataseg())
 	{
-	  csym->Sident = mangle();
+	  csym->Sident = shortMangle (mangle());
 	  csym->prettyIdent = toPrettyChars();
 	}
       else
@@ -393,7 +393,7 @@ FuncDeclaration::toSymbol (void)
 	  d_keep (fndecl);
 	  if (ident)
 	    {
-	      csym->Sident = mangle(); // save for making thunks
+	      csym->Sident = shortMangle (mangle()); // save for making thunks
 	      csym->prettyIdent = toPrettyChars();
 	      tree id = get_identifier (csym->Sident);
 	      id = targetm.mangle_decl_assembler_name (fndecl, id);
@@ -556,7 +556,7 @@ FuncDeclaration::toThunkSymbol (int offset)
       unsigned sz = strlen (csym->Sident) + 14;
       char *id = (char *) alloca (sz);
       snprintf (id, sz, "_DT%u%s", offset, csym->Sident);
-      sthunk = symbol_calloc (id);
+      sthunk = symbol_calloc (shortMangle (id));
 
       tree target_func_decl = csym->Stree;
       tree thunk_decl = build_decl (DECL_SOURCE_LOCATION (target_func_decl),
@@ -87,6 +87,37 @@ IdentityExp::toElem (IRState *irs)
     }
 }
 
+// Return true if arrays of T1 and T2 can be compared for equality with
+// memcmp, which holds for elements that are equal only when their bits
+// are.  Floating point elements are not, as 0.0 == -0.0 and nan != nan,
+// and neither are structs and classes, which may define opEquals.
+
+static bool
+bitwiseArrayEquals (Type *t1, Type *t2)
+{
+  t1 = t1->nextOf()->toBasetype();
+  t2 = t2->nextOf()->toBasetype();
+
+  if (t1->size() != t2->size())
+    return false;
+
+  return (t1->isintegral() || t1->ty == Tpointer || t1->ty == Tvoid)
+    && (t2->isintegral() || t2->ty == Tpointer || t2->ty == Tvoid);
+}
+
+// Return true if arrays of T1 and T2 are ordered the way memcmp orders
+// them, which only holds for unsigned byte elements.
+
+static bool
+bitwiseArrayCompare (Type *t1, Type *t2)
+{
+  t1 = t1->nextOf()->toBasetype();
+  t2 = t2->nextOf()->toBasetype();
+
+  return (t1->ty == Tvoid || (t1->size() == 1 && t1->isunsigned()))
+    && (t2->ty == Tvoid || (t2->size() == 1 && t2->isunsigned()));
+}
+
 elem *
 EqualExp::toElem (IRState *irs)
 {
@@ -108,6 +139,35 @@ EqualExp::toElem (IRState *irs)
   else if ((tb1->ty == Tsarray || tb1->ty == Tarray)
 	   && (tb2->ty == Tsarray || tb2->ty == Tarray))
     {
+      if (bitwiseArrayEquals (tb1, tb2))
+	{
+	  // Compare the lengths, then the contents as a block of memory:
+	  // e1.length == e2.length && memcmp (e1.ptr, e2.ptr, size) == 0
+	  tree t1 = irs->makeTemp (irs->toDArray (e1));
+	  tree t2 = irs->makeTemp (irs->toDArray (e2));
+	  tree len = irs->makeTemp (irs->darrayLenRef (t1));
+	  tree size = build2 (MULT_EXPR, size_type_node,
+			      convert (size_type_node, len),
+			      size_int (tb1->nextOf()->size()));
+
+	  tree t_memcmp = irs->buildCall (builtin_decl_explicit (BUILT_IN_MEMCMP), 3,
+					  irs->darrayPtrRef (t1),
+					  irs->darrayPtrRef (t2), size);
+
+	  // Don't pass memcmp the null pointers of empty arrays.
+	  tree t_data = irs->boolOp (TRUTH_ORIF_EXPR,
+				     irs->boolOp (EQ_EXPR, len, build_int_cst (TREE_TYPE (len), 0)),
+				     irs->boolOp (EQ_EXPR, t_memcmp, integer_zero_node));
+	  tree result = irs->boolOp (TRUTH_ANDIF_EXPR,
+				     irs->boolOp (EQ_EXPR, len, irs->darrayLenRef (t2)),
+				     t_data);
+	  result = irs->convertTo (type->toCtype(), result);
+	  if (op == TOKnotequal)
+	    result = build1 (TRUTH_NOT_EXPR, type->toCtype(), result);
+
+	  return result;
+	}
+
       // _adEq2 compares each element.
       Type *telem = tb1->nextOf()->toBasetype();
       tree args[3] = {
@@ -244,14 +304,48 @@ CmpExp::toElem (IRState *irs)
   if ((tb1->ty == Tsarray || tb1->ty == Tarray)
       && (tb2->ty == Tsarray || tb2->ty == Tarray))
     {
-      Type *telem = tb1->nextOf()->toBasetype();
-      tree args[3] = {
-	  irs->toDArray (e1),
-	  irs->toDArray (e2),
-	  irs->typeinfoReference (telem->arrayOf())
-      };
+      if (bitwiseArrayCompare (tb1, tb2))
+	{
+	  // Compare the common part with memcmp, and if that is the same,
+	  // the shorter array is less.
+	  tree t1 = irs->makeTemp (irs->toDArray (e1));
+	  tree t2 = irs->makeTemp (irs->toDArray (e2));
+	  tree len1 = irs->makeTemp (irs->darrayLenRef (t1));
+	  tree len2 = irs->makeTemp (irs->darrayLenRef (t2));
+	  tree len = irs->makeTemp (fold_build2 (MIN_EXPR, TREE_TYPE (len1), len1, len2));
+
+	  tree t_memcmp = irs->buildCall (builtin_decl_explicit (BUILT_IN_MEMCMP), 3,
+					  irs->darrayPtrRef (t1),
+					  irs->darrayPtrRef (t2),
+					  convert (size_type_node, len));
+
+	  // Don't pass memcmp the null pointers of empty arrays.
+	  tree t_data = build3 (COND_EXPR, integer_type_node,
+				irs->boolOp (EQ_EXPR, len, build_int_cst (TREE_TYPE (len), 0)),
+				integer_zero_node, t_memcmp);
+	  t_data = irs->makeTemp (t_data);
+
+	  tree t_len = build3 (COND_EXPR, integer_type_node,
+			       irs->boolOp (LT_EXPR, len1, len2),
+			       integer_minus_one_node,
+			       convert (integer_type_node,
+					irs->boolOp (GT_EXPR, len1, len2)));
+
+	  result = build3 (COND_EXPR, integer_type_node,
+			   irs->boolOp (NE_EXPR, t_data, integer_zero_node),
+			   t_data, t_len);
+	}
+      else
+	{
+	  Type *telem = tb1->nextOf()->toBasetype();
+	  tree args[3] = {
+	      irs->toDArray (e1),
+	      irs->toDArray (e2),
+	      irs->typeinfoReference (telem->arrayOf())
+	  };
 
-      result = irs->libCall (LIBCALL_ADCMP2, 3, args);
+	  result = irs->libCall (LIBCALL_ADCMP2, 3, args);
+	}
 
       // %% For float element types, warn that NaN is not taken into account?
 
@@ -1028,14 +1122,16 @@ IndexExp::toElem (IRState *irs)
     {
       Type *key_type = ((TypeAArray *) array_type)->index->toBasetype();
       AddrOfExpr aoe;
-      tree args[4] = {
+      tree args[5] = {
 	  e1->toElem (irs),
 	  irs->typeinfoReference (key_type),
 	  irs->integerConstant (array_type->nextOf()->size(), Type::tsize_t),
-	  aoe.set (irs, irs->convertTo (e2, key_type))
+	  aoe.set (irs, irs->convertTo (e2, key_type)),
+	  irs->aaKeyKind (key_type)
       };
-      LibCall libcall = modifiable ? LIBCALL_AAGETX : LIBCALL_AAGETRVALUEX;
-      tree t = irs->libCall (libcall, 4, args, type->pointerTo()->toCtype());
+      // Only _aaGetKX makes a table, so only it needs the key kind.
+      LibCall libcall = modifiable ? LIBCALL_AAGETKX : LIBCALL_AAGETRVALUEX;
+      tree t = irs->libCall (libcall, modifiable ? 5 : 4, args, type->pointerTo()->toCtype());
       t = aoe.finish (irs, t);
 
       if (irs->arrayBoundsCheck())
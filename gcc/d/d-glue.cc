@@ -111,6 +111,14 @@ FuncDeclaration::toObjFile (int)
   if (global.params.verbose)
     fprintf (stdmsg, "function  %s\n", this->toPrettyChars());
 
+  // The body of a function of an imported module is only there
+  // to be inlined, like a gnu_inline extern inline function in C.
+  if (DECL_EXTERNAL (fn_decl))
+    {
+      DECL_DECLARED_INLINE_P (fn_decl) = 1;
+      DECL_NO_INLINE_WARNING_P (fn_decl) = 1;
+    }
+
   IRState *irs = g.irs->startFunction (this);
 
   irs->useChain (NULL, NULL_TREE);
@@ -408,6 +416,11 @@ Module::genobjfile (int multiobj)
 	}
     }
 
+  // Bodies of imported functions to inline, given once per object file.
+  for (size_t i = 0; i < g.ofile->inlineImports.dim; i++)
+    g.ofile->inlineImports[i]->toObjFile (multiobj);
+  g.ofile->inlineImports.setDim (0);
+
   // Always generate module info.
   if (1 || needModuleInfo())
     {
@@ -444,18 +457,21 @@ StructDeclaration::toDebug (void)
 }
 
 /* Create debug information for a ClassDeclaration's inheritance tree.
-   Interfaces are not included. */
+   Interfaces are not included.  VTBL is the address of the vtable of the
+   most derived class, which the optimizer reads the targets of virtual
+   calls from. */
 static tree
-binfo_for (tree tgt_binfo, ClassDeclaration *cls)
+binfo_for (tree tgt_binfo, ClassDeclaration *cls, tree vtbl)
 {
   tree binfo = make_tree_binfo (1);
   TREE_TYPE (binfo) = TREE_TYPE (cls->type->toCtype()); // RECORD_TYPE, not REFERENCE_TYPE
+  BINFO_VTABLE (binfo) = vtbl;
   BINFO_INHERITANCE_CHAIN (binfo) = tgt_binfo;
   BINFO_OFFSET (binfo) = integer_zero_node;
 
   if (cls->baseClass)
     {
-      BINFO_BASE_APPEND (binfo, binfo_for (binfo, cls->baseClass));
+      BINFO_BASE_APPEND (binfo, binfo_for (binfo, cls->baseClass, vtbl));
 #ifdef BINFO_BASEACCESSES
 #error update vector stuff
       tree prot_tree;
@@ -539,12 +555,14 @@ intfc_binfo_for (tree tgt_binfo, ClassDeclaration *iface, unsigned& inout_offset
 void
 ClassDeclaration::toDebug (void)
 {
-  /* Used to create BINFO even if debugging was off.  This was needed to keep
-     references to inherited types. */
+  /* Called even if debugging is off, as the optimizer needs the BINFO of
+     a class to find its vtable.  This also keeps references to inherited
+     types. */
   tree rec_type = TREE_TYPE (type->toCtype());
 
   if (!isInterfaceDeclaration())
-    TYPE_BINFO (rec_type) = binfo_for (NULL_TREE, this);
+    TYPE_BINFO (rec_type) = binfo_for (NULL_TREE, this,
+				       gen.addressOf (toVtblSymbol()->Stree));
   else
     {
       unsigned offset = 0;
@@ -417,6 +417,98 @@ CaseStatement::toIR (IRState *irs)
     statement->toIR (irs);
 }
 
+// Return the value a string switch tests at level POS for CASE_STMT:
+// its length if POS is negative, else its character at POS.
+
+static dinteger_t
+stringCaseKey (CaseStatement *case_stmt, int pos)
+{
+  StringExp *se = (StringExp *) case_stmt->exp;
+  gcc_assert (se->op == TOKstring);
+  return pos < 0 ? se->len : se->charAt (pos);
+}
+
+// Build an expression for the index of the string LEN, PTR among the
+// sorted cases [LO .. HI), or -1 if it is none of them.  KEY is the part
+// of the string the cases are told apart by at level POS, which is the
+// length first and then one character at a time.  A memcmp of the whole
+// string confirms the one case left at the end.
+
+static tree
+switchStringIndex (IRState *irs, CaseStatements *cases, size_t lo, size_t hi,
+		   tree len, tree ptr, int pos, tree key)
+{
+  tree index_type = Type::tint32->toCtype();
+  tree not_found = irs->integerConstant (-1, index_type);
+  dinteger_t first = stringCaseKey ((*cases)[lo], pos);
+
+  if (first != stringCaseKey ((*cases)[hi - 1], pos))
+    {
+      // Split the cases near the middle, but never between two with the
+      // same key; the cases are sorted by it, so there is a split point.
+      size_t mid = (lo + hi) / 2;
+      dinteger_t mid_key = stringCaseKey ((*cases)[mid], pos);
+
+      while (mid > lo && stringCaseKey ((*cases)[mid - 1], pos) == mid_key)
+	mid--;
+      if (mid == lo)
+	{
+	  while (stringCaseKey ((*cases)[mid], pos) == first)
+	    mid++;
+	  mid_key = stringCaseKey ((*cases)[mid], pos);
+	}
+
+      tree cond = irs->boolOp (LT_EXPR, key,
+			       irs->integerConstant (mid_key, TREE_TYPE (key)));
+      return build3 (COND_EXPR, index_type, cond,
+		     switchStringIndex (irs, cases, lo, mid, len, ptr, pos, key),
+		     switchStringIndex (irs, cases, mid, hi, len, ptr, pos, key));
+    }
+
+  // All the cases left have this key.
+  StringExp *se = (StringExp *) (*cases)[lo]->exp;
+  tree match;
+
+  if (hi - lo == 1)
+    {
+      match = irs->integerConstant (lo, index_type);
+      if (se->len != 0)
+	{
+	  tree str = build_string (se->len * se->sz, (char *) se->string);
+	  TREE_CONSTANT (str) = 1;
+	  TREE_READONLY (str) = 1;
+	  TREE_TYPE (str) = irs->arrayType (TREE_TYPE (TREE_TYPE (ptr)), se->len);
+
+	  tree size = irs->integerConstant (se->len * se->sz, size_type_node);
+	  tree cmp = irs->buildCall (builtin_decl_explicit (BUILT_IN_MEMCMP), 3,
+				     ptr, irs->addressOf (str), size);
+	  match = build3 (COND_EXPR, index_type,
+			  irs->boolOp (EQ_EXPR, cmp, integer_zero_node),
+			  match, not_found);
+	}
+    }
+  else
+    {
+      // Skip the characters all these cases have in common.  They are
+      // sorted, so those are the ones the first and last have in common.
+      StringExp *last = (StringExp *) (*cases)[hi - 1]->exp;
+      int next = pos + 1;
+
+      while (se->charAt (next) == last->charAt (next))
+	next++;
+
+      tree elem_type = TREE_TYPE (TREE_TYPE (ptr));
+      tree chr = irs->indirect (elem_type,
+				irs->pointerOffset (ptr, size_int (next * se->sz)));
+      match = switchStringIndex (irs, cases, lo, hi, len, ptr, next,
+				 irs->makeTemp (chr));
+    }
+
+  tree cond = irs->boolOp (EQ_EXPR, key,
+			   irs->integerConstant (first, TREE_TYPE (key)));
+  return build3 (COND_EXPR, index_type, cond, match, not_found);
+}
+
 void
 SwitchStatement::toIR (IRState *irs)
 {
@@ -454,24 +546,41 @@ SwitchStatement::toIR (IRState *irs)
       // on the case array, have to change them to be useable.
       cases->sort(); // %%!!
 
-      Symbol *s = static_sym();
-      dt_t **  pdt = &s->Sdt;
-      s->Sseg = CDATA;
       for (size_t i = 0; i < cases->dim; i++)
 	{
 	  CaseStatement *case_stmt = (*cases)[i];
-	  pdt = case_stmt->exp->toDt (pdt);
 	  case_stmt->index = i;
 	}
-      outdata (s);
-      tree p_table = irs->addressOf (s->Stree);
 
-      tree args[2] = {
-	  irs->darrayVal (cond_type->arrayOf()->toCtype(), cases->dim, p_table),
-	  cond_tree
-      };
+      if (cases->dim != 0 && cases->dim <= (unsigned) flag_switch_string_limit)
+	{
+	  // Find the index inline, the same one the library would return.
+	  cond_tree = irs->makeTemp (cond_tree);
+	  tree len = irs->darrayLenRef (cond_tree);
+	  tree ptr = irs->darrayPtrRef (cond_tree);
+	  cond_tree = switchStringIndex (irs, cases, 0, cases->dim,
+					 len, ptr, -1, len);
+	}
+      else
+	{
+	  Symbol *s = static_sym();
+	  dt_t **  pdt = &s->Sdt;
+	  s->Sseg = CDATA;
+	  for (size_t i = 0; i < cases->dim; i++)
+	    {
+	      CaseStatement *case_stmt = (*cases)[i];
+	      pdt = case_stmt->exp->toDt (pdt);
+	    }
+	  outdata (s);
+	  tree p_table = irs->addressOf (s->Stree);
 
-      cond_tree = irs->libCall (libcall, 2, args);
+	  tree args[2] = {
+	      irs->darrayVal (cond_type->arrayOf()->toCtype(), cases->dim, p_table),
+	      cond_tree
+	  };
+
+	  cond_tree = irs->libCall (libcall, 2, args);
+	}
     }
   else if (!cond_type->isscalar())
     {
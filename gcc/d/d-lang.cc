@@ -30,11 +30,15 @@
 #include "d-confdefs.h"
 
 #include "root.h"
+#include "rmem.h"
 #include "mtype.h"
 #include "id.h"
+#include "lexer.h"
 #include "module.h"
 #include "cond.h"
 #include "mars.h"
+#include "template.h"
+#include "ctfe.h"
 
 #include "async.h"
 #include "json.h"
@@ -106,6 +110,8 @@ const struct attribute_spec d_attribute_table[] =
 
 
 static const char *fonly_arg;
+static const char *import_cache_arg;
+static const char *time_report_arg;
 
 /* Common initialization before calling option handlers.  */
 static void
@@ -343,6 +349,10 @@ d_handle_option (size_t scode, const char *arg, int value,
       global.params.noboundscheck = !value;
       break;
 
+    case OPT_fclosed_hierarchy:
+      global.params.closedHierarchy = value;
+      break;
+
     case OPT_fdebug:
       global.params.debuglevel = value ? 1 : 0;
       break;
@@ -396,6 +406,14 @@ d_handle_option (size_t scode, const char *arg, int value,
       global.params.verbose = value;
       break;
 
+    case OPT_fd_time_report_:
+      time_report_arg = xstrdup (arg);
+      break;
+
+    case OPT_fd_vclosures:
+      global.params.vclosures = value;
+      break;
+
     case OPT_fd_vtls:
       global.params.vtls = value;
       break;
@@ -443,6 +461,10 @@ d_handle_option (size_t scode, const char *arg, int value,
       global.params.hdrname = xstrdup (arg);
       break;
 
+    case OPT_fimport_cache_:
+      import_cache_arg = xstrdup (arg);
+      break;
+
     case OPT_finvariants:
       global.params.useInvariants = value;
       break;
@@ -463,6 +485,19 @@ d_handle_option (size_t scode, const char *arg, int value,
 	error ("bad argument for -fmake-deps");
       break;
 
+    case OPT_fmangle_limit_:
+      if (value != 0 && value < 32)
+	error ("bad argument for -fmangle-limit");
+      global.params.mangleLimit = value;
+      break;
+
+    case OPT_fmangle_map_:
+      global.params.mangleMapFile = xstrdup (arg);
+      if (!global.params.mangleMapFile[0])
+	error ("bad argument for -fmangle-map");
+      global.params.mangleMap = new OutBuffer;
+      break;
+
     case OPT_fonly_:
       fonly_arg = xstrdup (arg);
       break;
@@ -486,6 +521,11 @@ d_handle_option (size_t scode, const char *arg, int value,
       global.params.useSwitchError = !value;
       break;
 
+    case OPT_ftoken_cache_:
+      TokenCache::dir = xstrdup (arg);
+      FileName::ensurePathExists (TokenCache::dir);
+      break;
+
     case OPT_funittest:
       global.params.useUnitTests = value;
       break;
@@ -781,6 +821,165 @@ int binary(const char *p , const char **tab, int high)
     return -1;
 }
 
+/* Times and counters of the frontend, for -fd-time-report=.  */
+
+enum d_phase
+{
+  PHASE_PARSE,
+  PHASE_IMPORTALL,
+  PHASE_SEMANTIC,
+  PHASE_SEMANTIC2,
+  PHASE_SEMANTIC3,
+  PHASE_CODEGEN,
+  PHASE_MAX
+};
+
+static const char *d_phase_names[PHASE_MAX] =
+{
+  "parse", "importAll", "semantic", "semantic2", "semantic3", "codegen"
+};
+
+static double phase_wall[PHASE_MAX];
+static double phase_cpu[PHASE_MAX];
+static double phase_start_wall;
+static double phase_start_cpu;
+
+// The time taken by each module in each phase, as JSON objects.
+static OutBuffer *time_report_modules;
+
+static void
+d_get_time (double *wall, double *cpu)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  *wall = tv.tv_sec + tv.tv_usec * 1e-6;
+  *cpu = get_run_time () * 1e-6;
+}
+
+static void
+d_phase_start (void)
+{
+  if (time_report_arg)
+    d_get_time (&phase_start_wall, &phase_start_cpu);
+}
+
+/* Write the string S to BUF as a JSON string literal.  */
+
+static void
+d_write_json_string (OutBuffer *buf, const char *s)
+{
+  buf->writeByte ('"');
+  for (; *s; s++)
+    {
+      unsigned char c = *s;
+      if (c == '"' || c == '\\')
+	{
+	  buf->writeByte ('\\');
+	  buf->writeByte (c);
+	}
+      else if (c < 0x20)
+	buf->printf ("\\u%04x", c);
+      else
+	buf->writeByte (c);
+    }
+  buf->writeByte ('"');
+}
+
+static void
+d_phase_end (d_phase phase, Module *m)
+{
+  double wall, cpu;
+
+  if (!time_report_arg)
+    return;
+
+  d_get_time (&wall, &cpu);
+  wall -= phase_start_wall;
+  cpu -= phase_start_cpu;
+  phase_wall[phase] += wall;
+  phase_cpu[phase] += cpu;
+
+  if (!time_report_modules)
+    time_report_modules = new OutBuffer;
+  else
+    time_report_modules->writestring (",\n");
+  time_report_modules->writestring ("    {\"module\": ");
+  d_write_json_string (time_report_modules, m->toPrettyChars());
+  time_report_modules->printf (", \"phase\": \"%s\", "
+			       "\"wall\": %.6f, \"cpu\": %.6f}",
+			       d_phase_names[phase], wall, cpu);
+}
+
+static int
+d_instances_cmp (const void *p1, const void *p2)
+{
+  TemplateDeclaration *td1 = *(TemplateDeclaration **) p1;
+  TemplateDeclaration *td2 = *(TemplateDeclaration **) p2;
+
+  if (td1->numinstances != td2->numinstances)
+    return td1->numinstances > td2->numinstances ? -1 : 1;
+  return 0;
+}
+
+/* Write the report for -fd-time-report= as JSON, to stderr if the file
+   name is "-".  */
+
+static void
+d_write_time_report (void)
+{
+  OutBuffer buf;
+
+  buf.writestring ("{\n  \"phases\": {\n");
+  for (int i = 0; i < PHASE_MAX; i++)
+    buf.printf ("    \"%s\": {\"wall\": %.6f, \"cpu\": %.6f}%s\n",
+		d_phase_names[i], phase_wall[i], phase_cpu[i],
+		i + 1 < PHASE_MAX ? "," : "");
+
+  buf.writestring ("  },\n  \"modules\": [\n");
+  if (time_report_modules)
+    {
+      buf.write (time_report_modules);
+      buf.writestring ("\n");
+    }
+
+  // Most instantiated templates first.
+  Dsymbols templates;
+  templates.append (&TemplateDeclaration::instantiated);
+  qsort (templates.data, templates.dim, sizeof (Dsymbol *), d_instances_cmp);
+
+  buf.writestring ("  ],\n  \"templates\": [\n");
+  for (size_t i = 0; i < templates.dim; i++)
+    {
+      TemplateDeclaration *td = (TemplateDeclaration *) templates[i];
+      buf.writestring ("    {\"template\": ");
+      d_write_json_string (&buf, td->toPrettyChars());
+      buf.printf (", \"instances\": %llu}%s\n", td->numinstances,
+		  i + 1 < templates.dim ? "," : "");
+    }
+
+  buf.printf ("  ],\n  \"ctfe\": {\"calls\": %llu, \"statements\": %llu, "
+	      "\"bytecodeCalls\": %llu, \"memoHits\": %llu, "
+	      "\"memoMisses\": %llu, \"maxCallDepth\": %d, "
+	      "\"maxStack\": %llu},\n",
+	      CtfeStatus::numCalls, CtfeStatus::numStatements,
+	      CtfeStatus::numBytecodeCalls, CtfeStatus::numMemoHits,
+	      CtfeStatus::numMemoMisses, CtfeStatus::maxCallDepth,
+	      (ulonglong) CtfeStatus::maxStackUsage());
+  buf.printf ("  \"memory\": {\"allocated\": %llu}\n}\n",
+	      mem.allocated);
+
+  if (time_report_arg[0] == '-' && time_report_arg[1] == 0)
+    fwrite (buf.data, 1, buf.offset, stderr);
+  else
+    {
+      File f (time_report_arg);
+      f.setbuffer (buf.data, buf.offset);
+      f.ref = 1;
+      f.writev ();
+    }
+}
+
 void
 d_parse_file (void)
 {
@@ -902,6 +1101,9 @@ d_parse_file (void)
   gcc_assert (output_module);
 
   // Read files
+  if (import_cache_arg)
+    DirCache::load (import_cache_arg);
+
   aw = AsyncRead::create (modules.dim);
   for (size_t i = 0; i < modules.dim; i++)
     {
@@ -924,7 +1126,9 @@ d_parse_file (void)
 	  error ("cannot read file %s", m->srcfile->name->toChars());
 	  goto had_errors;
 	}
+      d_phase_start ();
       m->parse();
+      d_phase_end (PHASE_PARSE, m);
       d_gcc_magic_module (m);
       if (m->isDocFile)
 	{
@@ -936,6 +1140,9 @@ d_parse_file (void)
     }
   AsyncRead::dispose (aw);
 
+  if (global.params.verbose)
+    mem.stats ("parse");
+
   if (global.errors)
     goto had_errors;
 
@@ -966,7 +1173,9 @@ d_parse_file (void)
       m = modules[i];
       if (global.params.verbose)
 	fprintf (stdmsg, "importall %s\n", m->toChars());
+      d_phase_start ();
       m->importAll (0);
+      d_phase_end (PHASE_IMPORTALL, m);
     }
 
   if (global.errors)
@@ -978,9 +1187,14 @@ d_parse_file (void)
       m = modules[i];
       if (global.params.verbose)
 	fprintf (stdmsg, "semantic  %s\n", m->toChars());
+      d_phase_start ();
       m->semantic();
+      d_phase_end (PHASE_SEMANTIC, m);
     }
 
+  if (global.params.verbose)
+    mem.stats ("semantic");
+
   if (global.errors)
     goto had_errors;
 
@@ -993,9 +1207,14 @@ d_parse_file (void)
       m = modules[i];
       if (global.params.verbose)
 	fprintf (stdmsg, "semantic2 %s\n", m->toChars());
+      d_phase_start ();
       m->semantic2();
+      d_phase_end (PHASE_SEMANTIC2, m);
     }
 
+  if (global.params.verbose)
+    mem.stats ("semantic2");
+
   if (global.errors)
     goto had_errors;
 
@@ -1005,9 +1224,33 @@ d_parse_file (void)
       m = modules[i];
       if (global.params.verbose)
 	fprintf (stdmsg, "semantic3 %s\n", m->toChars());
+      d_phase_start ();
       m->semantic3();
+      d_phase_end (PHASE_SEMANTIC3, m);
     }
 
+  if (global.params.verbose)
+    mem.stats ("semantic3");
+
+  // Run semantic3 on the small functions of the modules that are only
+  // imported, so that the backend can inline them.  Without optimization
+  // their bodies would be thrown away unused.
+  if (flag_inline_imports && optimize)
+    {
+      for (size_t i = 0; i < Module::amodules.dim; i++)
+	{
+	  m = Module::amodules[i];
+	  if (m->importedFrom == m && (!fonly_arg || m == output_module))
+	    continue;
+	  if (global.params.verbose)
+	    fprintf (stdmsg, "inline    %s\n", m->toChars());
+	  m->inlineImports (&ObjectFile::inlineImports);
+	}
+    }
+
+  if (import_cache_arg)
+    DirCache::save (import_cache_arg);
+
   if (global.errors)
     goto had_errors;
 
@@ -1099,7 +1342,9 @@ d_parse_file (void)
       if (!flag_syntax_only)
 	{
 	  Obj::init ();
+	  d_phase_start ();
 	  m->genobjfile (false);
+	  d_phase_end (PHASE_CODEGEN, m);
 	  Obj::term ();
 	}
       if (!global.errors && !errorcount)
@@ -1115,6 +1360,21 @@ d_parse_file (void)
   // Add DMD error count to GCC error count to to exit with error status
   errorcount += (global.errors + global.warnings);
 
+  // All the symbols have been mangled by now.
+  if (global.params.mangleMap != NULL)
+    {
+      gcc_assert (global.params.mangleMapFile != NULL);
+
+      File map (global.params.mangleMapFile);
+      OutBuffer *ob = global.params.mangleMap;
+      map.setbuffer ((void *)ob->data, ob->offset);
+      map.ref = 1;
+      map.writev();
+    }
+
+  if (time_report_arg)
+    d_write_time_report ();
+
   g.ofile->finish();
   output_module = NULL;
 
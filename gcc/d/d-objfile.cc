@@ -32,6 +32,7 @@ unsigned  ObjectFile::moduleSearchIndex;
 DeferredThunks ObjectFile::deferredThunks;
 FuncDeclarations ObjectFile::staticCtorList;
 FuncDeclarations ObjectFile::staticDtorList;
+FuncDeclarations ObjectFile::inlineImports;
 
 void
 ObjectFile::beginModule (Module *m)
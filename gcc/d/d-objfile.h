@@ -117,6 +117,10 @@ struct ObjectFile
   static FuncDeclarations staticCtorList; // usually only one.
   static FuncDeclarations staticDtorList; // only if __attribute__(destructor) is used.
 
+  // ** Small functions of imported modules, whose bodies are given
+  // to the backend for inlining but never output.
+  static FuncDeclarations inlineImports;
+
   /* support for multiple modules per object file */
   static bool hasModule (Module *m);
   static Modules modules;
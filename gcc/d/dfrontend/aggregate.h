@@ -239,6 +239,8 @@ struct ClassDeclaration : AggregateDeclaration
                                         // it derives from IUnknown)
     int isscope;                         // !=0 if this is an auto class
     int isabstract;                     // !=0 if abstract class
+    bool publicDerived;                 // !=0 if a class that is not private
+                                        // derives from this one
 #if DMDV1
     bool isnested;                      // !=0 if is nested
     VarDeclaration *vthis;              // 'this' parameter if this class is nested
@@ -261,6 +263,8 @@ struct ClassDeclaration : AggregateDeclaration
     int isFuncHidden(FuncDeclaration *fd);
 #endif
     FuncDeclaration *findFunc(Identifier *ident, TypeFunction *tf);
+    int isHierarchyClosed();
+    FuncDeclaration *devirtualize(FuncDeclaration *fd);
     void interfaceSemantic(Scope *sc);
 #if DMDV1
     int isNested();
@@ -13,9 +13,9 @@
 #include <stdlib.h>
 #include <assert.h>
 
-#ifndef IN_GCC
+#define POSIX (linux || __APPLE__ || __FreeBSD__ || __OpenBSD__ || __sun)
 
-#if _WIN32
+#if _WIN32 && !IN_GCC
 
 #include <windows.h>
 #include <errno.h>
@@ -121,11 +121,12 @@ unsigned __stdcall startthread(void *p)
     return EXIT_SUCCESS;                // if skidding
 }
 
-#elif linux  // Posix
+#elif POSIX
 
 #include <errno.h>
 #include <pthread.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "root.h"
 
@@ -137,14 +138,16 @@ void err_abort(int status, const char *msg)
     exit(EXIT_FAILURE);
 }
 
+/* Files are read by a pool of up to this many threads, each of which
+ * takes the next file not yet started.
+ */
+#define MAXTHREADS      8
+
 struct FileData
 {
     File *file;
     int result;
-
-    pthread_mutex_t mutex;
-    pthread_cond_t cond;
-    int value;
+    int value;                  // !=0 once file has been read
 };
 
 struct AsyncRead
@@ -155,6 +158,12 @@ struct AsyncRead
     int read(size_t i);
     static void dispose(AsyncRead *);
 
+    pthread_mutex_t mutex;      // guards next and files[].value
+    pthread_cond_t cond;        // signalled whenever a file has been read
+    size_t next;                // next file for a thread to read
+    size_t nthreads;
+    pthread_t threads[MAXTHREADS];
+
     size_t filesdim;
     size_t filesmax;
     FileData files[1];
@@ -166,6 +175,13 @@ AsyncRead *AsyncRead::create(size_t nfiles)
     AsyncRead *aw = (AsyncRead *)calloc(1, sizeof(AsyncRead) +
                                 (nfiles - 1) * sizeof(FileData));
     aw->filesmax = nfiles;
+
+    int status = pthread_mutex_init(&aw->mutex, NULL);
+    if (status != 0)
+        err_abort(status, "init mutex");
+    status = pthread_cond_init(&aw->cond, NULL);
+    if (status != 0)
+        err_abort(status, "init cond");
     return aw;
 }
 
@@ -174,26 +190,22 @@ void AsyncRead::addFile(File *file)
     //printf("addFile(file = %p)\n", file);
     //printf("filesdim = %d, filesmax = %d\n", filesdim, filesmax);
     assert(filesdim < filesmax);
-    FileData *f = &files[filesdim];
-    f->file = file;
-
-    int status = pthread_mutex_init(&f->mutex, NULL);
-    if (status != 0)
-        err_abort(status, "init mutex");
-    status = pthread_cond_init(&f->cond, NULL);
-    if (status != 0)
-        err_abort(status, "init cond");
-
+    files[filesdim].file = file;
     filesdim++;
 }
 
 void AsyncRead::start()
 {
     //printf("aw->filesdim = %p %d\n", this, filesdim);
-    if (filesdim)
+    size_t n = filesdim;
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus > 0 && n > (size_t)ncpus)
+        n = ncpus;
+    if (n > MAXTHREADS)
+        n = MAXTHREADS;
+    for (nthreads = 0; nthreads < n; nthreads++)
     {
-        pthread_t thread_id;
-        int status = pthread_create(&thread_id,
+        int status = pthread_create(&threads[nthreads],
             NULL,
             &startthread,
             this);
@@ -207,16 +219,16 @@ int AsyncRead::read(size_t i)
     FileData *f = &files[i];
 
     // Wait for the event
-    int status = pthread_mutex_lock(&f->mutex);
+    int status = pthread_mutex_lock(&mutex);
     if (status != 0)
         err_abort(status, "lock mutex");
     while (f->value == 0)
     {
-        status = pthread_cond_wait(&f->cond, &f->mutex);
+        status = pthread_cond_wait(&cond, &mutex);
         if (status != 0)
             err_abort(status, "wait on condition");
     }
-    status = pthread_mutex_unlock(&f->mutex);
+    status = pthread_mutex_unlock(&mutex);
     if (status != 0)
         err_abort(status, "unlock mutex");
 
@@ -226,16 +238,18 @@ int AsyncRead::read(size_t i)
 void AsyncRead::dispose(AsyncRead *aw)
 {
     //printf("AsyncRead::dispose()\n");
-    for (int i = 0; i < aw->filesdim; i++)
+    for (size_t i = 0; i < aw->nthreads; i++)
     {
-        FileData *f = &aw->files[i];
-        int status = pthread_cond_destroy(&f->cond);
+        int status = pthread_join(aw->threads[i], NULL);
         if (status != 0)
-            err_abort(status, "cond destroy");
-        status = pthread_mutex_destroy(&f->mutex);
-        if (status != 0)
-            err_abort(status, "mutex destroy");
+            err_abort(status, "join thread");
     }
+    int status = pthread_cond_destroy(&aw->cond);
+    if (status != 0)
+        err_abort(status, "cond destroy");
+    status = pthread_mutex_destroy(&aw->mutex);
+    if (status != 0)
+        err_abort(status, "mutex destroy");
     free(aw);
 }
 
@@ -245,21 +259,32 @@ void *startthread(void *p)
     AsyncRead *aw = (AsyncRead *)p;
 
     //printf("startthread: aw->filesdim = %p %d\n", aw, aw->filesdim);
-    size_t dim = aw->filesdim;
-    for (size_t i = 0; i < dim; i++)
-    {   FileData *f = &aw->files[i];
+    while (1)
+    {
+        // Take the next file
+        int status = pthread_mutex_lock(&aw->mutex);
+        if (status != 0)
+            err_abort(status, "lock mutex");
+        size_t i = aw->next++;
+        status = pthread_mutex_unlock(&aw->mutex);
+        if (status != 0)
+            err_abort(status, "unlock mutex");
+        if (i >= aw->filesdim)
+            break;
 
-        f->result = f->file->read();
+        FileData *f = &aw->files[i];
+        int result = f->file->mmread();
 
         // Set event
-        int status = pthread_mutex_lock(&f->mutex);
+        status = pthread_mutex_lock(&aw->mutex);
         if (status != 0)
             err_abort(status, "lock mutex");
+        f->result = result;
         f->value = 1;
-        status = pthread_cond_signal(&f->cond);
+        status = pthread_cond_broadcast(&aw->cond);
         if (status != 0)
             err_abort(status, "signal condition");
-        status = pthread_mutex_unlock(&f->mutex);
+        status = pthread_mutex_unlock(&aw->mutex);
         if (status != 0)
             err_abort(status, "unlock mutex");
     }
@@ -267,8 +292,6 @@ void *startthread(void *p)
     return NULL;                        // end thread
 }
 
-#endif
-
 #else
 
 #include <stdio.h>
@@ -1690,9 +1690,10 @@ Expression *DelegateExp::castTo(Scope *sc, Type *t)
                     if (f->tintro && f->tintro->nextOf()->isBaseOf(f->type->nextOf(), &offset) && offset)
                         error("%s", msg);
                     f->tookAddressOf++;
-                    e = new DelegateExp(loc, e1, f);
-                    e->type = t;
-                    return e;
+                    DelegateExp *de = new DelegateExp(loc, e1, f);
+                    de->tookAddress = 1;
+                    de->type = t;
+                    return de;
                 }
                 if (func->tintro)
                     error("%s", msg);
@@ -1708,6 +1709,7 @@ Expression *DelegateExp::castTo(Scope *sc, Type *t)
             error("%s", msg);
         e = copy();
         e->type = t;
+        ((DelegateExp *)e)->tookAddress++;
     }
     return e;
 }
@@ -65,6 +65,7 @@ ClassDeclaration::ClassDeclaration(Loc loc, Identifier *id, BaseClasses *basecla
 
     vtblsym = NULL;
     vclassinfo = NULL;
+    publicDerived = false;
 
     if (id)
     {   // Look for special class names
@@ -392,6 +393,15 @@ void ClassDeclaration::semantic(Scope *sc)
                 else
                 {   baseClass = tc->sym;
                     b->base = baseClass;
+
+                    /* Calls of the methods of a private class are made
+                     * directly when no class of its module overrides them,
+                     * see devirtualize().
+                     */
+                    if (baseClass->protection == PROTprivate &&
+                        baseClass->getModule() != getModule())
+                        error("cannot derive from private class %s of module %s",
+                            baseClass->toChars(), baseClass->getModule()->toChars());
                 }
              L7: ;
             }
@@ -517,6 +527,15 @@ void ClassDeclaration::semantic(Scope *sc)
     protection = sc->protection;
     storage_class |= sc->stc;
 
+    /* Other modules may derive from the bases of a class that is not
+     * private through it, see isHierarchyClosed().
+     */
+    if (protection != PROTprivate)
+    {
+        for (ClassDeclaration *cd = baseClass; cd; cd = cd->baseClass)
+            cd->publicDerived = true;
+    }
+
     if (sizeok == SIZEOKnone)
     {
         interfaceSemantic(sc);
@@ -1037,6 +1056,56 @@ int ClassDeclaration::isFuncHidden(FuncDeclaration *fd)
 }
 #endif
 
+/****************
+ * Return !=0 if every class derived from this one is known to the
+ * compiler: private classes can only be derived from in their own module,
+ * unless a class there that is not private derives from them, or a
+ * template there is instantiated elsewhere, and with closedHierarchy
+ * nothing outside the modules on the command line derives from their
+ * classes.
+ */
+
+int ClassDeclaration::isHierarchyClosed()
+{
+    Module *m = getModule();
+    if (!m || m->importedFrom != m)
+        return 0;               // not a module being compiled
+    if (global.params.closedHierarchy)
+        return 1;
+    return protection == PROTprivate && !publicDerived && !m->hastemplates;
+}
+
+/****************
+ * Return the function a virtual call of fd through a reference to
+ * this class always reaches, or NULL if it may reach more than one.
+ */
+
+FuncDeclaration *ClassDeclaration::devirtualize(FuncDeclaration *fd)
+{
+    if (isInterfaceDeclaration() ||
+        !fd->isVirtual() ||
+        fd->toParent()->isInterfaceDeclaration() ||
+        fd->vtblIndex < 0 || fd->vtblIndex >= vtbl.dim)
+        return NULL;
+
+    FuncDeclaration *f = vtbl[fd->vtblIndex]->isFuncDeclaration();
+    if (!f || f->isAbstract())
+        return NULL;
+
+    // A covariant override returning an interface needs its result adjusted
+    if (f != fd && f->tintro)
+        return NULL;
+
+    // Nothing can derive from a final class
+    if (f->isFinal() || storage_class & STCfinal)
+        return f;
+
+    if (!f->overridden && isHierarchyClosed())
+        return f;
+
+    return NULL;
+}
+
 /****************
  * Find virtual function matching identifier and type.
  * Used to build virtual function tables for interface implementations.
@@ -25,10 +25,46 @@ struct CtfeStatus
                                            * suppress this number of calls
                                            */
     static int maxCallDepth; // highest number of recursive calls
-    static int numArrayAllocs; // Number of allocated arrays
-    static int numAssignments; // total number of assignments executed
+    static ulonglong numArrayAllocs; // Number of allocated arrays
+    static ulonglong numAssignments; // total number of assignments executed
+    static ulonglong numBytecodeFunctions; // functions compiled to bytecode
+    static ulonglong numBytecodeCalls; // calls run by the bytecode interpreter
+    static ulonglong numCalls; // function calls interpreted
+    static ulonglong numStatements; // statements interpreted
+    static ulonglong numMemoHits; // pure calls whose result was memoized
+    static ulonglong numMemoMisses; // pure calls that could have been
+    static size_t maxStackUsage(); // most variables ever on the stack
 };
 
+#define CTFE_RECURSION_LIMIT 1000
+
+/** Memoized calls to strongly pure functions with plain value arguments,
+    see ctfeexpr.c
+ */
+struct CtfeMemoEntry;
+
+/// Look up fd(eargs), setting *presult to a copy of the result if found.
+/// Returns an entry to pass to ctfeMemoSave() if not found but could be.
+CtfeMemoEntry *ctfeMemoFind(FuncDeclaration *fd, Expression *thisarg, Expressions *eargs,
+        Expression **presult);
+
+/// Remember e as the result of the call that made entry me.
+void ctfeMemoSave(CtfeMemoEntry *me, Expression *e);
+
+/** Bytecode interpreter for functions using only integral values and
+    arrays of them, see ctfebc.c
+ */
+struct CtfeCode;
+
+#define CTFECODE_FAILED ((CtfeCode *)1)
+
+/// Compile fd to bytecode if possible. Returns NULL if it cannot be.
+CtfeCode *ctfeCompileFunction(FuncDeclaration *fd);
+
+/// Run fd with the bytecode interpreter on the evaluated arguments eargs.
+/// Returns NULL if fd must be run by the AST interpreter instead.
+Expression *ctfeRunBytecode(Loc loc, FuncDeclaration *fd, Expressions *eargs);
+
 
 /** Expression subclasses which only exist in CTFE */
 
@@ -201,6 +237,10 @@ TypeAArray *toBuiltinAAType(Type *t);
  */
 Expression *findKeyInAA(Loc loc, AssocArrayLiteralExp *ae, Expression *e2);
 
+/// Keys have been removed from an AA literal, invalidating the hash
+/// tables findKeyInAA keeps for large literals.
+void aaKeysRemoved();
+
 /***********************************************
       In-place integer operations
 ***********************************************/
@@ -232,6 +272,12 @@ int ctfeCmp(Loc loc, enum TOK op, Expression *e1, Expression *e2);
 /// Returns e1 ~ e2. Resolves slices before concatenation.
 Expression *ctfeCat(Type *type, Expression *e1, Expression *e2);
 
+/// Returns e1 ~= e2. Appends in place to strings owned by CTFE.
+Expression *ctfeCatAssign(Type *type, Expression *e1, Expression *e2);
+
+/// Stop string se from being appended to in place, as it leaves CTFE.
+void freezeCtfeString(StringExp *se);
+
 /// Same as for constfold.Index, except that it only works for static arrays,
 /// dynamic arrays, and strings.
 Expression *ctfeIndex(Loc loc, Type *type, Expression *e1, uinteger_t indx);
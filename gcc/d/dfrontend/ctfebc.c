@@ -0,0 +1,1818 @@
+// Compiler implementation of the D programming language
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>                     // mem{cpy|set}()
+
+#include "rmem.h"
+#include "aav.h"
+
+#include "statement.h"
+#include "expression.h"
+#include "init.h"
+#include "mtype.h"
+#include "declaration.h"
+#include "attrib.h"
+#include "ctfe.h"
+
+#define LOG     0
+
+/* A bytecode interpreter for the part of CTFE which only deals with
+ * integral values and dynamic arrays of them.
+ *
+ * On its first call a function is compiled into code for a simple register
+ * machine; from then on it runs without walking the AST, and without
+ * creating an Expression for every intermediate value. Values are only
+ * converted to and from Expressions where the AST interpreter calls in.
+ *
+ * Anything outside of that subset makes the compilation fail, and the
+ * function is left to the AST interpreter. A run which hits an error
+ * (array bounds, division by zero, assert, recursion limit) is abandoned.
+ * The bytecode cannot change anything outside its own frames, so the call
+ * is then simply repeated by the AST interpreter, which reports the error,
+ * and the function is not run as bytecode again.
+ */
+
+enum CtfeOp
+{
+    BCfail,             // abandon the run
+    BCconst,            // a = consts[b]
+    BCnull,             // a = null
+    BCmov,              // a = b
+    BCnorm,             // a = cast(ty)b
+    BCbool,             // a = b != 0
+    BCneg,              // a = -b
+    BCcom,              // a = ~b
+    BCnot,              // a = !b
+
+    BCadd,              // a = b op c
+    BCmin,
+    BCmul,
+    BCdiv,
+    BCmod,
+    BCand,
+    BCor,
+    BCxor,
+    BCshl,
+    BCshr,
+    BCushr,
+    BCeq,
+    BCne,
+    BClt,
+    BCle,
+    BCgt,
+    BCge,
+
+    BCjmp,              // goto a
+    BCjz,               // if (!b) goto a
+    BCjnz,              // if (b) goto a
+    BCassert,           // if (!b) fail
+    BCret,              // return b
+    BCretvoid,          // return
+    BCcall,             // a = funcs[b](c, c + 1, ...)
+
+    BCnewarray,         // a = new T[b], elements initialized to consts[c]
+    BCconstarray,       // a = arrays[b], duplicated if c
+    BClen,              // a = b.length
+    BCsetlen,           // a.length = b, new elements initialized to consts[c]
+    BCindex,            // a = b[c]
+    BCsetindex,         // a[b] = c
+    BCslice,            // a = b[c .. c + 1]
+    BCcat,              // a = b ~ c
+    BCappend,           // a ~= b
+    BCappendelem,       // a ~= [b]
+    BCarreq,            // a = b == c
+};
+
+#define CTFEsize        0x0F    // size of an integral type in bytes
+#define CTFEsigned      0x10    // integral type is signed
+
+/* Arrays longer than this are left to the AST interpreter.
+ */
+#define CTFE_MAX_ARRAY  0x4000000
+
+struct CtfeInsn
+{
+    unsigned char op;           // CtfeOp
+    unsigned char ty;           // CTFEsize and CTFEsigned of the operation
+    int a;
+    int b;
+    int c;
+};
+
+struct CtfeArray
+{
+    dinteger_t *data;
+    size_t dim;                 // number of elements used by any slice
+    size_t allocdim;            // number of elements allocated
+};
+
+struct CtfeValue
+{
+    dinteger_t value;           // an integral value, or the length of an array
+    CtfeArray *arr;             // storage of an array, NULL for a null array
+    size_t lwr;                 // index of the first element of the array in arr
+};
+
+struct CtfeCode
+{
+    FuncDeclaration *fd;
+    CtfeInsn *code;
+    dinteger_t *consts;
+    ArrayBase<CtfeArray> arrays;        // array literals
+    FuncDeclarations funcs;             // functions called
+    int nparams;                // parameters are the first registers
+    int nregs;
+    bool compiling;             // fd is being compiled
+    bool mutableArrayArgs;      // some parameter is an array of mutable elements
+
+    CtfeCode(FuncDeclaration *fd);
+};
+
+CtfeCode::CtfeCode(FuncDeclaration *fd)
+{
+    this->fd = fd;
+    code = NULL;
+    consts = NULL;
+    nparams = 0;
+    nregs = 0;
+    compiling = true;
+    mutableArrayArgs = false;
+}
+
+struct CtfeCompiler
+{
+    CtfeCode *code;
+    OutBuffer insns;            // CtfeInsn's
+    OutBuffer consts;           // dinteger_t's
+    int nregs;
+    AA *vars;                   // VarDeclaration* => its register + 1
+    AA *labels;                 // CaseStatement* or DefaultStatement* => its pc + 1
+    ArrayBase<void> *breaks;    // jumps to the end of the innermost loop or switch
+    ArrayBase<void> *continues; // jumps to the next iteration of the innermost loop
+
+    CtfeCompiler(CtfeCode *code);
+    int reg();
+    size_t pc();
+    size_t emit(int op, int ty, int a, int b = 0, int c = 0);
+    void patch(size_t insn, size_t target);
+    void patchAll(ArrayBase<void> *jumps, size_t target);
+    int constant(dinteger_t value);
+    int array(CtfeArray *arr);
+    int func(FuncDeclaration *fd);
+    int getVar(VarDeclaration *v);
+    int declareVar(VarDeclaration *v, int r);
+};
+
+CtfeCompiler::CtfeCompiler(CtfeCode *code)
+{
+    this->code = code;
+    nregs = 0;
+    vars = NULL;
+    labels = NULL;
+    breaks = NULL;
+    continues = NULL;
+}
+
+int CtfeCompiler::reg()
+{
+    return nregs++;
+}
+
+size_t CtfeCompiler::pc()
+{
+    return insns.offset / sizeof(CtfeInsn);
+}
+
+size_t CtfeCompiler::emit(int op, int ty, int a, int b, int c)
+{
+    CtfeInsn insn;
+    insn.op = op;
+    insn.ty = ty;
+    insn.a = a;
+    insn.b = b;
+    insn.c = c;
+    size_t at = pc();
+    insns.write(&insn, sizeof(insn));
+    return at;
+}
+
+/* Set the target of the jump at insn.
+ */
+void CtfeCompiler::patch(size_t insn, size_t target)
+{
+    ((CtfeInsn *)insns.data)[insn].a = target;
+}
+
+void CtfeCompiler::patchAll(ArrayBase<void> *jumps, size_t target)
+{
+    for (size_t i = 0; i < jumps->dim; i++)
+        patch((size_t)(*jumps)[i], target);
+}
+
+int CtfeCompiler::constant(dinteger_t value)
+{
+    int i = consts.offset / sizeof(dinteger_t);
+    consts.write(&value, sizeof(value));
+    return i;
+}
+
+int CtfeCompiler::array(CtfeArray *arr)
+{
+    code->arrays.push(arr);
+    return code->arrays.dim - 1;
+}
+
+int CtfeCompiler::func(FuncDeclaration *fd)
+{
+    for (size_t i = 0; i < code->funcs.dim; i++)
+    {
+        if (code->funcs[i] == fd)
+            return i;
+    }
+    code->funcs.push(fd);
+    return code->funcs.dim - 1;
+}
+
+/* Return the register of local variable v, -1 if it has none.
+ */
+int CtfeCompiler::getVar(VarDeclaration *v)
+{
+    return (int)(size_t)_aaGetRvalue(vars, v) - 1;
+}
+
+int CtfeCompiler::declareVar(VarDeclaration *v, int r)
+{
+    *_aaGet(&vars, v) = (void *)(size_t)(r + 1);
+    return r;
+}
+
+/************** Types ********************************************/
+
+static int isScalar(Type *t)
+{
+    switch (t->toBasetype()->ty)
+    {
+        case Tint8:
+        case Tuns8:
+        case Tint16:
+        case Tuns16:
+        case Tint32:
+        case Tuns32:
+        case Tint64:
+        case Tuns64:
+        case Tbool:
+        case Tchar:
+        case Twchar:
+        case Tdchar:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int isScalarArray(Type *t)
+{
+    t = t->toBasetype();
+    return t->ty == Tarray && isScalar(t->nextOf());
+}
+
+static int isVoid(Type *t)
+{
+    return t->toBasetype()->ty == Tvoid;
+}
+
+static unsigned char typeFlags(Type *t)
+{
+    t = t->toBasetype();
+    unsigned char ty = (unsigned char)t->size();
+    if (t->ty != Tbool && !t->isunsigned())
+        ty |= CTFEsigned;
+    return ty;
+}
+
+/* Truncate value to the integral type described by ty, sign extending
+ * signed types. All registers hold values normalized this way.
+ */
+static dinteger_t normalize(dinteger_t value, unsigned ty)
+{
+    switch (ty)
+    {
+        case 1:                 return (d_uns8)value;
+        case 1 | CTFEsigned:    return (d_int8)value;
+        case 2:                 return (d_uns16)value;
+        case 2 | CTFEsigned:    return (d_int16)value;
+        case 4:                 return (d_uns32)value;
+        case 4 | CTFEsigned:    return (d_int32)value;
+        default:                return value;
+    }
+}
+
+static dinteger_t defaultValue(Type *t)
+{
+    return t->defaultInit()->toInteger();
+}
+
+/************** Arrays ********************************************/
+
+static CtfeArray *newArray(size_t dim, size_t allocdim)
+{
+    CtfeArray *arr = (CtfeArray *)mem.malloc(sizeof(CtfeArray));
+    arr->data = (dinteger_t *)mem.malloc((allocdim ? allocdim : 1) * sizeof(dinteger_t));
+    arr->dim = dim;
+    arr->allocdim = allocdim;
+    ++CtfeStatus::numArrayAllocs;
+    return arr;
+}
+
+/* Make room for n more elements at the end of the slice v.
+ * Like the runtime, this grows the slice in place if it ends at the end of
+ * the storage and there is capacity left, else it copies the slice.
+ * Returns a pointer to the new elements.
+ */
+static dinteger_t *extendArray(CtfeValue *v, size_t n)
+{
+    size_t len = v->value;
+    CtfeArray *arr = v->arr;
+    if (arr && v->lwr + len == arr->dim && arr->dim + n <= arr->allocdim)
+        arr->dim += n;
+    else
+    {
+        size_t newdim = len + n;
+        CtfeArray *newarr = newArray(newdim, newdim + newdim / 2 + 16);
+        if (len)
+            memcpy(newarr->data, arr->data + v->lwr, len * sizeof(dinteger_t));
+        v->arr = newarr;
+        v->lwr = 0;
+    }
+    v->value = len + n;
+    return v->arr->data + v->lwr + len;
+}
+
+/************** Compiling statements ********************************************/
+
+/***********************************
+ * Compile the statement into cc.
+ * Returns:
+ *      !=0     compiled
+ *      0       the statement is not supported by the bytecode interpreter
+ */
+
+int Statement::ctfeCompile(CtfeCompiler *cc)
+{
+#if LOG
+    printf("%s Statement::ctfeCompile() %s\n", loc.toChars(), toChars());
+#endif
+    return 0;
+}
+
+int ExpStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    return !exp || exp->ctfeCompile(cc) >= 0;
+}
+
+int CompoundStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    for (size_t i = 0; statements && i < statements->dim; i++)
+    {   Statement *s = (*statements)[i];
+
+        if (s && !s->ctfeCompile(cc))
+            return 0;
+    }
+    return 1;
+}
+
+int ScopeStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    return !statement || statement->ctfeCompile(cc);
+}
+
+int IfStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    if (match || !isScalar(condition->type))
+        return 0;
+    int rc = condition->ctfeCompile(cc);
+    if (rc < 0)
+        return 0;
+    size_t jelse = cc->emit(BCjz, 0, 0, rc);
+    if (ifbody && !ifbody->ctfeCompile(cc))
+        return 0;
+    if (elsebody)
+    {
+        size_t jend = cc->emit(BCjmp, 0, 0);
+        cc->patch(jelse, cc->pc());
+        if (!elsebody->ctfeCompile(cc))
+            return 0;
+        cc->patch(jend, cc->pc());
+    }
+    else
+        cc->patch(jelse, cc->pc());
+    return 1;
+}
+
+int ForStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    if (init && !init->ctfeCompile(cc))
+        return 0;
+
+    ArrayBase<void> breaks;
+    ArrayBase<void> continues;
+    ArrayBase<void> *oldbreaks = cc->breaks;
+    ArrayBase<void> *oldcontinues = cc->continues;
+    cc->breaks = &breaks;
+    cc->continues = &continues;
+
+    int result = 0;
+    size_t top = cc->pc();
+    if (condition)
+    {
+        if (!isScalar(condition->type))
+            goto Lend;
+        int rc = condition->ctfeCompile(cc);
+        if (rc < 0)
+            goto Lend;
+        breaks.push((void *)cc->emit(BCjz, 0, 0, rc));
+    }
+    if (body && !body->ctfeCompile(cc))
+        goto Lend;
+    cc->patchAll(&continues, cc->pc());
+    if (increment && increment->ctfeCompile(cc) < 0)
+        goto Lend;
+    cc->emit(BCjmp, 0, top);
+    cc->patchAll(&breaks, cc->pc());
+    result = 1;
+
+Lend:
+    cc->breaks = oldbreaks;
+    cc->continues = oldcontinues;
+    return result;
+}
+
+int DoStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    if (!isScalar(condition->type))
+        return 0;
+
+    ArrayBase<void> breaks;
+    ArrayBase<void> continues;
+    ArrayBase<void> *oldbreaks = cc->breaks;
+    ArrayBase<void> *oldcontinues = cc->continues;
+    cc->breaks = &breaks;
+    cc->continues = &continues;
+
+    int result = 0;
+    size_t top = cc->pc();
+    if (!body || body->ctfeCompile(cc))
+    {
+        cc->patchAll(&continues, cc->pc());
+        int rc = condition->ctfeCompile(cc);
+        if (rc >= 0)
+        {
+            cc->emit(BCjnz, 0, top, rc);
+            cc->patchAll(&breaks, cc->pc());
+            result = 1;
+        }
+    }
+    cc->breaks = oldbreaks;
+    cc->continues = oldcontinues;
+    return result;
+}
+
+int SwitchStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    if (hasVars || !isScalar(condition->type))
+        return 0;
+    int rc = condition->ctfeCompile(cc);
+    if (rc < 0)
+        return 0;
+
+    /* Compare against each case in turn, then go to the default
+     */
+    unsigned char ty = typeFlags(condition->type);
+    ArrayBase<void> jcases;
+    for (size_t i = 0; i < cases->dim; i++)
+    {   CaseStatement *cs = (*cases)[i];
+
+        if (cs->exp->op != TOKint64)
+            return 0;
+        int rk = cc->reg();
+        cc->emit(BCconst, 0, rk, cc->constant(cs->exp->toInteger()));
+        int rt = cc->reg();
+        cc->emit(BCeq, ty, rt, rc, rk);
+        jcases.push((void *)cc->emit(BCjnz, 0, 0, rt));
+    }
+    size_t jdefault = cc->emit(sdefault ? BCjmp : BCfail, 0, 0);
+
+    ArrayBase<void> breaks;
+    ArrayBase<void> *oldbreaks = cc->breaks;
+    cc->breaks = &breaks;
+    int result = body->ctfeCompile(cc);
+    cc->breaks = oldbreaks;
+    if (!result)
+        return 0;
+
+    for (size_t i = 0; i < cases->dim; i++)
+    {
+        size_t target = (size_t)_aaGetRvalue(cc->labels, (*cases)[i]);
+        if (!target)
+            return 0;
+        cc->patch((size_t)jcases[i], target - 1);
+    }
+    if (sdefault)
+    {
+        size_t target = (size_t)_aaGetRvalue(cc->labels, sdefault);
+        if (!target)
+            return 0;
+        cc->patch(jdefault, target - 1);
+    }
+    cc->patchAll(&breaks, cc->pc());
+    return 1;
+}
+
+int CaseStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    *_aaGet(&cc->labels, this) = (void *)(cc->pc() + 1);
+    return statement->ctfeCompile(cc);
+}
+
+int DefaultStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    *_aaGet(&cc->labels, this) = (void *)(cc->pc() + 1);
+    return statement->ctfeCompile(cc);
+}
+
+int ReturnStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    if (!exp)
+    {
+        cc->emit(BCretvoid, 0, 0);
+        return 1;
+    }
+    int r = exp->ctfeCompile(cc);
+    if (r < 0)
+        return 0;
+    if (isVoid(exp->type))
+        cc->emit(BCretvoid, 0, 0);
+    else
+        cc->emit(BCret, 0, 0, r);
+    return 1;
+}
+
+int BreakStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    if (ident || !cc->breaks)
+        return 0;
+    cc->breaks->push((void *)cc->emit(BCjmp, 0, 0));
+    return 1;
+}
+
+int ContinueStatement::ctfeCompile(CtfeCompiler *cc)
+{
+    if (ident || !cc->continues)
+        return 0;
+    cc->continues->push((void *)cc->emit(BCjmp, 0, 0));
+    return 1;
+}
+
+/************** Compiling expressions ********************************************/
+
+/* An lvalue: either a local variable, or an element of an array.
+ */
+struct CtfeLvalue
+{
+    int var;                    // register of the variable, -1 if an element
+    int arr;                    // registers of the array and the index
+    int index;
+    unsigned char ty;
+};
+
+static int compileLvalue(CtfeCompiler *cc, Expression *e, CtfeLvalue *lv)
+{
+    if (!isScalar(e->type) && !isScalarArray(e->type))
+        return 0;
+    lv->ty = isScalar(e->type) ? typeFlags(e->type) : 0;
+    if (e->op == TOKvar)
+    {
+        VarDeclaration *v = ((VarExp *)e)->var->isVarDeclaration();
+        lv->var = v ? cc->getVar(v) : -1;
+        return lv->var >= 0;
+    }
+    if (e->op == TOKindex)
+    {
+        IndexExp *ie = (IndexExp *)e;
+        if (!isScalar(e->type) || ie->e1->type->toBasetype()->ty != Tarray)
+            return 0;
+        lv->var = -1;
+        lv->arr = ie->e1->ctfeCompile(cc);
+        if (lv->arr < 0)
+            return 0;
+        if (ie->lengthVar)
+            cc->emit(BClen, 0, cc->declareVar(ie->lengthVar, cc->reg()), lv->arr);
+        lv->index = ie->e2->ctfeCompile(cc);
+        return lv->index >= 0;
+    }
+    return 0;
+}
+
+/* Return a register holding the current value of lv.
+ */
+static int loadLvalue(CtfeCompiler *cc, CtfeLvalue *lv)
+{
+    if (lv->var >= 0)
+        return lv->var;
+    int r = cc->reg();
+    cc->emit(BCindex, 0, r, lv->arr, lv->index);
+    return r;
+}
+
+static void storeLvalue(CtfeCompiler *cc, CtfeLvalue *lv, int r)
+{
+    if (lv->var < 0)
+        cc->emit(BCsetindex, lv->ty, lv->arr, lv->index, r);
+    else if (lv->ty)
+        cc->emit(BCnorm, lv->ty, lv->var, r);
+    else
+        cc->emit(BCmov, 0, lv->var, r);
+}
+
+/* Emit code to make a one element array out of the scalar in r.
+ */
+static int compileArrayOf(CtfeCompiler *cc, int r)
+{
+    int rlen = cc->reg();
+    cc->emit(BCconst, 0, rlen, cc->constant(1));
+    int rarr = cc->reg();
+    cc->emit(BCnewarray, 0, rarr, rlen, cc->constant(0));
+    int rindex = cc->reg();
+    cc->emit(BCconst, 0, rindex, cc->constant(0));
+    cc->emit(BCsetindex, 0, rarr, rindex, r);
+    return rarr;
+}
+
+/***********************************
+ * Compile the expression into cc.
+ * Returns:
+ *      the register holding its value
+ *      -1      the expression is not supported by the bytecode interpreter
+ */
+
+int Expression::ctfeCompile(CtfeCompiler *cc)
+{
+#if LOG
+    printf("%s Expression::ctfeCompile() %s\n", loc.toChars(), toChars());
+#endif
+    return -1;
+}
+
+int IntegerExp::ctfeCompile(CtfeCompiler *cc)
+{
+    if (op != TOKint64 || !isScalar(type))
+        return -1;
+    int r = cc->reg();
+    cc->emit(BCconst, 0, r, cc->constant(toInteger()));
+    return r;
+}
+
+int NullExp::ctfeCompile(CtfeCompiler *cc)
+{
+    if (!isScalarArray(type))
+        return -1;
+    int r = cc->reg();
+    cc->emit(BCnull, 0, r);
+    return r;
+}
+
+int StringExp::ctfeCompile(CtfeCompiler *cc)
+{
+    Type *tb = type->toBasetype();
+    if (tb->ty != Tarray || !isScalar(tb->nextOf()) || tb->nextOf()->size() != sz)
+        return -1;
+    unsigned char ty = typeFlags(tb->nextOf());
+    CtfeArray *arr = newArray(len, len);
+    for (size_t i = 0; i < len; i++)
+        arr->data[i] = normalize(charAt(i), ty);
+    int r = cc->reg();
+    cc->emit(BCconstarray, 0, r, cc->array(arr), tb->nextOf()->isMutable());
+    return r;
+}
+
+int ArrayLiteralExp::ctfeCompile(CtfeCompiler *cc)
+{
+    Type *tb = type->toBasetype();
+    if (tb->ty != Tarray || !isScalar(tb->nextOf()))
+        return -1;
+    unsigned char ty = typeFlags(tb->nextOf());
+    size_t dim = elements ? elements->dim : 0;
+    size_t i;
+    for (i = 0; i < dim; i++)
+    {
+        if ((*elements)[i]->op != TOKint64)
+            break;
+    }
+    int r = cc->reg();
+    if (i == dim)
+    {   // All elements are constant
+        CtfeArray *arr = newArray(dim, dim);
+        for (i = 0; i < dim; i++)
+            arr->data[i] = normalize((*elements)[i]->toInteger(), ty);
+        cc->emit(BCconstarray, 0, r, cc->array(arr), tb->nextOf()->isMutable());
+        return r;
+    }
+    int rlen = cc->reg();
+    cc->emit(BCconst, 0, rlen, cc->constant(dim));
+    cc->emit(BCnewarray, 0, r, rlen, cc->constant(0));
+    for (i = 0; i < dim; i++)
+    {
+        int re = (*elements)[i]->ctfeCompile(cc);
+        if (re < 0)
+            return -1;
+        int rindex = cc->reg();
+        cc->emit(BCconst, 0, rindex, cc->constant(i));
+        cc->emit(BCsetindex, ty, r, rindex, re);
+    }
+    return r;
+}
+
+int VarExp::ctfeCompile(CtfeCompiler *cc)
+{
+    VarDeclaration *v = var->isVarDeclaration();
+    if (!v)
+        return -1;
+    int rv = cc->getVar(v);
+    if (rv < 0)
+    {   /* Not a local, but a constant with a literal initializer
+         * can still be read.
+         */
+        if (!v->init || !(v->isConst() || v->isImmutable() || (v->storage_class & STCmanifest)) ||
+            (!isScalar(v->type) && !isScalarArray(v->type)))
+            return -1;
+        Expression *e = v->init->toExpression();
+        if (!e || !e->type ||
+            (e->op != TOKint64 && e->op != TOKstring && e->op != TOKarrayliteral && e->op != TOKnull))
+            return -1;
+        return e->ctfeCompile(cc);
+    }
+    int r = cc->reg();
+    cc->emit(BCmov, 0, r, rv);
+    return r;
+}
+
+int DeclarationExp::ctfeCompile(CtfeCompiler *cc)
+{
+    VarDeclaration *v = declaration->isVarDeclaration();
+    if (!v)
+    {
+        if (declaration->isAttribDeclaration() ||
+            declaration->isTemplateMixin() ||
+            declaration->isTupleDeclaration())
+            return -1;
+        // Others contain no executable code
+        return cc->reg();
+    }
+    if (v->storage_class & STCmanifest)
+        return cc->reg();
+    if (v->toAlias() != v || v->isDataseg() || !v->init ||
+        (!isScalar(v->type) && !isScalarArray(v->type)))
+        return -1;
+    ExpInitializer *ie = v->init->isExpInitializer();
+    if (!ie)
+        return -1;
+
+    if (v->storage_class & STCref)
+    {   /* A reference to another local, such as the key of a foreach,
+         * shares its register.
+         */
+        Expression *e = ie->exp;
+        if (e->op == TOKconstruct || e->op == TOKblit || e->op == TOKassign)
+            e = ((AssignExp *)e)->e2;
+        if (e->op != TOKvar || !((VarExp *)e)->var->isVarDeclaration())
+            return -1;
+        int rv = cc->getVar(((VarExp *)e)->var->isVarDeclaration());
+        if (rv < 0)
+            return -1;
+        return cc->declareVar(v, rv);
+    }
+
+    cc->declareVar(v, cc->reg());
+    if (ie->exp->ctfeCompile(cc) < 0)
+        return -1;
+    return cc->getVar(v);
+}
+
+int NewExp::ctfeCompile(CtfeCompiler *cc)
+{
+    Type *tb = newtype->toBasetype();
+    if (thisexp || newargs || member || allocator ||
+        tb->ty != Tarray || !isScalar(tb->nextOf()) ||
+        !arguments || arguments->dim != 1)
+        return -1;
+    int rlen = (*arguments)[0]->ctfeCompile(cc);
+    if (rlen < 0)
+        return -1;
+    int r = cc->reg();
+    cc->emit(BCnewarray, 0, r, rlen, cc->constant(defaultValue(tb->nextOf())));
+    return r;
+}
+
+int CallExp::ctfeCompile(CtfeCompiler *cc)
+{
+    if (e1->op != TOKvar)
+        return -1;
+    FuncDeclaration *fd = ((VarExp *)e1)->var->isFuncDeclaration();
+    if (!fd || (!isScalar(type) && !isScalarArray(type) && !isVoid(type)))
+        return -1;
+
+    /* Callees which have been through semantic already are compiled now,
+     * so that this function is left to the AST interpreter if they
+     * cannot be. Others are compiled when they are first called.
+     */
+    if (fd->semanticRun >= PASSsemantic3done && !ctfeCompileFunction(fd))
+        return -1;
+
+    // Arguments go into consecutive registers
+    size_t dim = arguments ? arguments->dim : 0;
+    int base = cc->nregs;
+    cc->nregs += dim;
+    for (size_t i = 0; i < dim; i++)
+    {
+        int ra = (*arguments)[i]->ctfeCompile(cc);
+        if (ra < 0)
+            return -1;
+        cc->emit(BCmov, 0, base + i, ra);
+    }
+    int r = cc->reg();
+    cc->emit(BCcall, 0, r, cc->func(fd), base);
+    return r;
+}
+
+int AssertExp::ctfeCompile(CtfeCompiler *cc)
+{
+    if (!isScalar(e1->type))
+        return -1;
+    int r = e1->ctfeCompile(cc);
+    if (r < 0)
+        return -1;
+    cc->emit(BCassert, 0, 0, r);
+    return r;
+}
+
+int HaltExp::ctfeCompile(CtfeCompiler *cc)
+{
+    cc->emit(BCfail, 0, 0);
+    return cc->reg();
+}
+
+int CastExp::ctfeCompile(CtfeCompiler *cc)
+{
+    Type *tto = type->toBasetype();
+    Type *tfrom = e1->type->toBasetype();
+    int r1;
+    if (tto->ty == Tvoid)
+        return e1->ctfeCompile(cc);
+    if (isScalar(tto) && isScalar(tfrom))
+    {
+        r1 = e1->ctfeCompile(cc);
+        if (r1 < 0)
+            return -1;
+        int r = cc->reg();
+        if (tto->ty == Tbool)
+            cc->emit(BCbool, 0, r, r1);
+        else
+            cc->emit(BCnorm, typeFlags(tto), r, r1);
+        return r;
+    }
+    if (isScalarArray(tto) && isScalarArray(tfrom) &&
+        typeFlags(tto->nextOf()) == typeFlags(tfrom->nextOf()))
+    {   // Only a change of qualifiers
+        return e1->ctfeCompile(cc);
+    }
+    return -1;
+}
+
+int UnaExp::ctfeCompile(CtfeCompiler *cc)
+{
+    int bop;
+    switch (op)
+    {
+        case TOKneg:    bop = BCneg;    break;
+        case TOKtilde:  bop = BCcom;    break;
+        case TOKnot:    bop = BCnot;    break;
+        case TOKtobool: bop = BCbool;   break;
+        default:
+            return -1;
+    }
+    if (!isScalar(e1->type) || !isScalar(type))
+        return -1;
+    int r1 = e1->ctfeCompile(cc);
+    if (r1 < 0)
+        return -1;
+    int r = cc->reg();
+    cc->emit(bop, typeFlags(type), r, r1);
+    return r;
+}
+
+int SliceExp::ctfeCompile(CtfeCompiler *cc)
+{
+    if (type->toBasetype()->ty != Tarray || !isScalarArray(e1->type))
+        return -1;
+    int rarr = e1->ctfeCompile(cc);
+    if (rarr < 0)
+        return -1;
+    if (!lwr && !upr)
+        return rarr;
+    if (lengthVar)
+        cc->emit(BClen, 0, cc->declareVar(lengthVar, cc->reg()), rarr);
+
+    // The bounds go into consecutive registers
+    int rbounds = cc->reg();
+    cc->reg();
+    int rb;
+    if (lwr)
+    {
+        if ((rb = lwr->ctfeCompile(cc)) < 0)
+            return -1;
+        cc->emit(BCmov, 0, rbounds, rb);
+    }
+    else
+        cc->emit(BCconst, 0, rbounds, cc->constant(0));
+    if (upr)
+    {
+        if ((rb = upr->ctfeCompile(cc)) < 0)
+            return -1;
+        cc->emit(BCmov, 0, rbounds + 1, rb);
+    }
+    else
+        cc->emit(BClen, 0, rbounds + 1, rarr);
+    int r = cc->reg();
+    cc->emit(BCslice, 0, r, rarr, rbounds);
+    return r;
+}
+
+int ArrayLengthExp::ctfeCompile(CtfeCompiler *cc)
+{
+    if (!isScalarArray(e1->type))
+        return -1;
+    int rarr = e1->ctfeCompile(cc);
+    if (rarr < 0)
+        return -1;
+    int r = cc->reg();
+    cc->emit(BClen, 0, r, rarr);
+    return r;
+}
+
+int IndexExp::ctfeCompile(CtfeCompiler *cc)
+{
+    if (e1->type->toBasetype()->ty != Tarray || !isScalar(type))
+        return -1;
+    int rarr = e1->ctfeCompile(cc);
+    if (rarr < 0)
+        return -1;
+    if (lengthVar)
+        cc->emit(BClen, 0, cc->declareVar(lengthVar, cc->reg()), rarr);
+    int rindex = e2->ctfeCompile(cc);
+    if (rindex < 0)
+        return -1;
+    int r = cc->reg();
+    cc->emit(BCindex, 0, r, rarr, rindex);
+    return r;
+}
+
+int CommaExp::ctfeCompile(CtfeCompiler *cc)
+{
+    if (e1->ctfeCompile(cc) < 0)
+        return -1;
+    return e2->ctfeCompile(cc);
+}
+
+int CondExp::ctfeCompile(CtfeCompiler *cc)
+{
+    if (!isScalar(econd->type) ||
+        (!isScalar(type) && !isScalarArray(type) && !isVoid(type)))
+        return -1;
+    int rc = econd->ctfeCompile(cc);
+    if (rc < 0)
+        return -1;
+    int r = cc->reg();
+    size_t jelse = cc->emit(BCjz, 0, 0, rc);
+    int r1 = e1->ctfeCompile(cc);
+    if (r1 < 0)
+        return -1;
+    cc->emit(BCmov, 0, r, r1);
+    size_t jend = cc->emit(BCjmp, 0, 0);
+    cc->patch(jelse, cc->pc());
+    int r2 = e2->ctfeCompile(cc);
+    if (r2 < 0)
+        return -1;
+    cc->emit(BCmov, 0, r, r2);
+    cc->patch(jend, cc->pc());
+    return r;
+}
+
+/* e1 && e2 and e1 || e2
+ */
+static int compileLogical(CtfeCompiler *cc, BinExp *e, int jop)
+{
+    if (!isScalar(e->e1->type) || (!isScalar(e->e2->type) && !isVoid(e->e2->type)))
+        return -1;
+    int r1 = e->e1->ctfeCompile(cc);
+    if (r1 < 0)
+        return -1;
+    int r = cc->reg();
+    cc->emit(BCbool, 0, r, r1);
+    size_t jend = cc->emit(jop, 0, 0, r);
+    int r2 = e->e2->ctfeCompile(cc);
+    if (r2 < 0)
+        return -1;
+    if (!isVoid(e->e2->type))
+        cc->emit(BCbool, 0, r, r2);
+    cc->patch(jend, cc->pc());
+    return r;
+}
+
+int AndAndExp::ctfeCompile(CtfeCompiler *cc)
+{
+    return compileLogical(cc, this, BCjz);
+}
+
+int OrOrExp::ctfeCompile(CtfeCompiler *cc)
+{
+    return compileLogical(cc, this, BCjnz);
+}
+
+int CatExp::ctfeCompile(CtfeCompiler *cc)
+{
+    if (!isScalarArray(type))
+        return -1;
+    unsigned char ty = typeFlags(type->toBasetype()->nextOf());
+    int r1 = -1;
+    int r2 = -1;
+    for (int i = 0; i < 2; i++)
+    {   Expression *e = i ? e2 : e1;
+
+        int r = e->ctfeCompile(cc);
+        if (r < 0)
+            return -1;
+        if (isScalar(e->type) && typeFlags(e->type) == ty)
+            r = compileArrayOf(cc, r);
+        else if (!isScalarArray(e->type) || typeFlags(e->type->toBasetype()->nextOf()) != ty)
+            return -1;
+        if (i)
+            r2 = r;
+        else
+            r1 = r;
+    }
+    int r = cc->reg();
+    cc->emit(BCcat, 0, r, r1, r2);
+    return r;
+}
+
+int PostExp::ctfeCompile(CtfeCompiler *cc)
+{
+    CtfeLvalue lv;
+    if (!isScalar(e1->type) || !compileLvalue(cc, e1, &lv))
+        return -1;
+    int r2 = e2->ctfeCompile(cc);
+    if (r2 < 0)
+        return -1;
+    int rold = cc->reg();
+    cc->emit(BCmov, 0, rold, loadLvalue(cc, &lv));
+    int rnew = cc->reg();
+    cc->emit(op == TOKplusplus ? BCadd : BCmin, lv.ty, rnew, rold, r2);
+    storeLvalue(cc, &lv, rnew);
+    return rold;
+}
+
+int AssignExp::ctfeCompile(CtfeCompiler *cc)
+{
+    if (ismemset)
+        return -1;
+    if (e1->op == TOKarraylength)
+    {   // array.length = n
+        Expression *ea = ((ArrayLengthExp *)e1)->e1;
+        if (ea->op != TOKvar || !isScalarArray(ea->type) || !isScalar(e2->type))
+            return -1;
+        VarDeclaration *v = ((VarExp *)ea)->var->isVarDeclaration();
+        int rv = v ? cc->getVar(v) : -1;
+        if (rv < 0)
+            return -1;
+        int r = e2->ctfeCompile(cc);
+        if (r < 0)
+            return -1;
+        cc->emit(BCsetlen, 0, rv, r, cc->constant(defaultValue(ea->type->toBasetype()->nextOf())));
+        return r;
+    }
+
+    if (isScalar(e1->type) ? !isScalar(e2->type)
+                           : !isScalarArray(e2->type) ||
+                             typeFlags(e1->type->toBasetype()->nextOf()) !=
+                             typeFlags(e2->type->toBasetype()->nextOf()))
+        return -1;
+    CtfeLvalue lv;
+    if (!compileLvalue(cc, e1, &lv))
+        return -1;
+    int r = e2->ctfeCompile(cc);
+    if (r < 0)
+        return -1;
+    storeLvalue(cc, &lv, r);
+    return r;
+}
+
+int BinAssignExp::ctfeCompile(CtfeCompiler *cc)
+{
+    CtfeLvalue lv;
+    if (op == TOKcatass)
+    {   /* Append to a local array
+         */
+        if (e1->op != TOKvar || !isScalarArray(e1->type) || !compileLvalue(cc, e1, &lv))
+            return -1;
+        unsigned char ty = typeFlags(e1->type->toBasetype()->nextOf());
+        int bop;
+        if (isScalar(e2->type) && typeFlags(e2->type) == ty)
+            bop = BCappendelem;
+        else if (isScalarArray(e2->type) && typeFlags(e2->type->toBasetype()->nextOf()) == ty)
+            bop = BCappend;
+        else
+            return -1;
+        int r2 = e2->ctfeCompile(cc);
+        if (r2 < 0)
+            return -1;
+        cc->emit(bop, ty, lv.var, r2);
+        return lv.var;
+    }
+
+    int bop;
+    switch (op)
+    {
+        case TOKaddass:         bop = BCadd;    break;
+        case TOKminass:         bop = BCmin;    break;
+        case TOKmulass:         bop = BCmul;    break;
+        case TOKdivass:         bop = BCdiv;    break;
+        case TOKmodass:         bop = BCmod;    break;
+        case TOKandass:         bop = BCand;    break;
+        case TOKorass:          bop = BCor;     break;
+        case TOKxorass:         bop = BCxor;    break;
+        case TOKshlass:         bop = BCshl;    break;
+        case TOKshrass:         bop = BCshr;    break;
+        case TOKushrass:        bop = BCushr;   break;
+        default:
+            return -1;
+    }
+    if (!isScalar(e1->type) || !isScalar(e2->type))
+        return -1;
+    // The signedness of a division must not depend on e2
+    if ((bop == BCdiv || bop == BCmod) && typeFlags(e1->type) != typeFlags(e2->type))
+        return -1;
+    if (!compileLvalue(cc, e1, &lv))
+        return -1;
+    int r2 = e2->ctfeCompile(cc);
+    if (r2 < 0)
+        return -1;
+    int r = cc->reg();
+    cc->emit(bop, lv.ty, r, loadLvalue(cc, &lv), r2);
+    storeLvalue(cc, &lv, r);
+    return r;
+}
+
+/* Arithmetic, comparisons and equality.
+ */
+int BinExp::ctfeCompile(CtfeCompiler *cc)
+{
+    int bop;
+    switch (op)
+    {
+        case TOKadd:    bop = BCadd;    break;
+        case TOKmin:    bop = BCmin;    break;
+        case TOKmul:    bop = BCmul;    break;
+        case TOKdiv:    bop = BCdiv;    break;
+        case TOKmod:    bop = BCmod;    break;
+        case TOKand:    bop = BCand;    break;
+        case TOKor:     bop = BCor;     break;
+        case TOKxor:    bop = BCxor;    break;
+        case TOKshl:    bop = BCshl;    break;
+        case TOKshr:    bop = BCshr;    break;
+        case TOKushr:   bop = BCushr;   break;
+        case TOKlt:     bop = BClt;     break;
+        case TOKle:     bop = BCle;     break;
+        case TOKgt:     bop = BCgt;     break;
+        case TOKge:     bop = BCge;     break;
+        case TOKequal:
+        case TOKidentity:
+                        bop = BCeq;     break;
+        case TOKnotequal:
+        case TOKnotidentity:
+                        bop = BCne;     break;
+        default:
+            return -1;
+    }
+
+    unsigned char ty;
+    int isarray = 0;
+    if (isScalar(e1->type) && isScalar(e2->type))
+    {
+        if (bop >= BCeq)
+        {   // Comparisons are done in the common type of the operands
+            ty = typeFlags(e1->type);
+            if (ty != typeFlags(e2->type))
+                return -1;
+        }
+        else
+        {
+            if (!isScalar(type))
+                return -1;
+            ty = typeFlags(type);
+            if (ty != typeFlags(e1->type) ||
+                ((bop == BCdiv || bop == BCmod) && ty != typeFlags(e2->type)))
+                return -1;
+        }
+    }
+    else if ((op == TOKequal || op == TOKnotequal) &&
+        isScalarArray(e1->type) && isScalarArray(e2->type) &&
+        typeFlags(e1->type->toBasetype()->nextOf()) == typeFlags(e2->type->toBasetype()->nextOf()))
+    {
+        isarray = 1;
+        ty = 0;
+    }
+    else
+        return -1;
+
+    int r1 = e1->ctfeCompile(cc);
+    if (r1 < 0)
+        return -1;
+    int r2 = e2->ctfeCompile(cc);
+    if (r2 < 0)
+        return -1;
+    int r = cc->reg();
+    if (isarray)
+    {
+        cc->emit(BCarreq, 0, r, r1, r2);
+        if (bop == BCne)
+            cc->emit(BCnot, 0, r, r);
+    }
+    else
+        cc->emit(bop, ty, r, r1, r2);
+    return r;
+}
+
+/************** Compiling functions ********************************************/
+
+/***********************************
+ * Compile fd if that has not been tried yet.
+ * Returns:
+ *      the compiled code, which may still be being compiled
+ *      NULL    fd is left to the AST interpreter
+ */
+
+CtfeCode *ctfeCompileFunction(FuncDeclaration *fd)
+{
+    if (fd->ctfeCode)
+        return fd->ctfeCode == CTFECODE_FAILED ? NULL : fd->ctfeCode;
+    if (fd->semanticRun < PASSsemantic3done)
+        return NULL;
+
+    TypeFunction *tf = (TypeFunction *)fd->type->toBasetype();
+    assert(tf->ty == Tfunction);
+    CtfeCode *code = new CtfeCode(fd);
+    fd->ctfeCode = code;
+    CtfeCompiler cc(code);
+
+    if (!fd->fbody || fd->needThis() || fd->isNested() ||
+        fd->frequire || fd->fensure || fd->vresult ||
+        fd->isBuiltin() != BUILTINunknown ||
+        tf->varargs || tf->isref ||
+        (!isScalar(tf->next) && !isScalarArray(tf->next) && !isVoid(tf->next)))
+        goto Lfail;
+
+    if (fd->parameters)
+    {
+        for (size_t i = 0; i < fd->parameters->dim; i++)
+        {   VarDeclaration *v = (*fd->parameters)[i];
+
+            if (v->storage_class & (STCout | STCref | STClazy))
+                goto Lfail;
+            if (isScalarArray(v->type))
+            {
+                if (v->type->toBasetype()->nextOf()->isMutable())
+                    code->mutableArrayArgs = true;
+            }
+            else if (!isScalar(v->type))
+                goto Lfail;
+            cc.declareVar(v, cc.reg());
+        }
+        code->nparams = fd->parameters->dim;
+    }
+
+    if (!fd->fbody->ctfeCompile(&cc))
+        goto Lfail;
+    // Falling off the end returns from a void function
+    cc.emit(isVoid(tf->next) ? BCretvoid : BCfail, 0, 0);
+
+    code->code = (CtfeInsn *)cc.insns.extractData();
+    code->consts = (dinteger_t *)cc.consts.extractData();
+    code->nregs = cc.nregs;
+    code->compiling = false;
+    ++CtfeStatus::numBytecodeFunctions;
+#if LOG
+    printf("%s compiled %s for CTFE: %d instructions, %d registers\n",
+        fd->loc.toChars(), fd->toChars(), (int)cc.pc(), cc.nregs);
+#endif
+    return code;
+
+Lfail:
+#if LOG
+    printf("%s cannot compile %s for CTFE\n", fd->loc.toChars(), fd->toChars());
+#endif
+    fd->ctfeCode = CTFECODE_FAILED;
+    return NULL;
+}
+
+/************** Running ********************************************/
+
+/* Registers of all active frames. As this is reallocated as it grows,
+ * frames are addressed by their index.
+ */
+static CtfeValue *stack;
+static size_t stacktop;
+static size_t stackdim;
+static int depth;               // number of active frames
+
+static size_t pushFrame(int nregs)
+{
+    size_t fp = stacktop;
+    if (fp + nregs > stackdim)
+    {
+        stackdim = (fp + nregs) * 2 + 256;
+        stack = (CtfeValue *)mem.realloc(stack, stackdim * sizeof(CtfeValue));
+    }
+    memset(stack + fp, 0, nregs * sizeof(CtfeValue));
+    stacktop = fp + nregs;
+    return fp;
+}
+
+/***********************************
+ * Run code in the frame at fp, its arguments already in its first registers.
+ * Returns:
+ *      !=0     success, the return value is in *result
+ *      0       the run was abandoned
+ */
+
+static int execute(CtfeCode *code, size_t fp, CtfeValue *result)
+{
+    CtfeValue *regs = stack + fp;
+    CtfeInsn *pc = code->code;
+
+#define R(n)    (regs[n].value)
+#define SR(n)   ((sinteger_t)regs[n].value)
+
+    while (1)
+    {
+        CtfeInsn *i = pc++;
+        switch (i->op)
+        {
+            case BCfail:
+                return 0;
+
+            case BCconst:
+                R(i->a) = code->consts[i->b];
+                break;
+
+            case BCnull:
+                regs[i->a].value = 0;
+                regs[i->a].arr = NULL;
+                regs[i->a].lwr = 0;
+                break;
+
+            case BCmov:
+                regs[i->a] = regs[i->b];
+                break;
+
+            case BCnorm:    R(i->a) = normalize(R(i->b), i->ty);        break;
+            case BCbool:    R(i->a) = R(i->b) != 0;                     break;
+            case BCneg:     R(i->a) = normalize(-R(i->b), i->ty);       break;
+            case BCcom:     R(i->a) = normalize(~R(i->b), i->ty);       break;
+            case BCnot:     R(i->a) = R(i->b) == 0;                     break;
+
+            case BCadd:     R(i->a) = normalize(R(i->b) + R(i->c), i->ty);      break;
+            case BCmin:     R(i->a) = normalize(R(i->b) - R(i->c), i->ty);      break;
+            case BCmul:     R(i->a) = normalize(R(i->b) * R(i->c), i->ty);      break;
+            case BCand:     R(i->a) = R(i->b) & R(i->c);                        break;
+            case BCor:      R(i->a) = R(i->b) | R(i->c);                        break;
+            case BCxor:     R(i->a) = R(i->b) ^ R(i->c);                        break;
+
+            case BCdiv:
+            case BCmod:
+                if (R(i->c) == 0)
+                    return 0;
+                if (i->ty & CTFEsigned)
+                {
+                    if (SR(i->c) == -1 && R(i->b) == (dinteger_t)1 << 63)
+                        return 0;
+                    R(i->a) = normalize(i->op == BCdiv ? SR(i->b) / SR(i->c)
+                                                       : SR(i->b) % SR(i->c), i->ty);
+                }
+                else
+                    R(i->a) = normalize(i->op == BCdiv ? R(i->b) / R(i->c)
+                                                       : R(i->b) % R(i->c), i->ty);
+                break;
+
+            case BCshl:
+            case BCshr:
+            case BCushr:
+            {
+                if (R(i->c) >= 64)
+                    return 0;
+                dinteger_t v = R(i->b);
+                if (i->op == BCshl)
+                    v <<= R(i->c);
+                else if (i->op == BCshr && (i->ty & CTFEsigned))
+                    v = (sinteger_t)v >> R(i->c);
+                else
+                    v = normalize(v, i->ty & CTFEsize) >> R(i->c);
+                R(i->a) = normalize(v, i->ty);
+                break;
+            }
+
+            case BCeq:      R(i->a) = R(i->b) == R(i->c);       break;
+            case BCne:      R(i->a) = R(i->b) != R(i->c);       break;
+            case BClt:
+                R(i->a) = (i->ty & CTFEsigned) ? SR(i->b) < SR(i->c) : R(i->b) < R(i->c);
+                break;
+            case BCle:
+                R(i->a) = (i->ty & CTFEsigned) ? SR(i->b) <= SR(i->c) : R(i->b) <= R(i->c);
+                break;
+            case BCgt:
+                R(i->a) = (i->ty & CTFEsigned) ? SR(i->b) > SR(i->c) : R(i->b) > R(i->c);
+                break;
+            case BCge:
+                R(i->a) = (i->ty & CTFEsigned) ? SR(i->b) >= SR(i->c) : R(i->b) >= R(i->c);
+                break;
+
+            case BCjmp:
+                pc = code->code + i->a;
+                break;
+
+            case BCjz:
+                if (!R(i->b))
+                    pc = code->code + i->a;
+                break;
+
+            case BCjnz:
+                if (R(i->b))
+                    pc = code->code + i->a;
+                break;
+
+            case BCassert:
+                if (!R(i->b))
+                    return 0;
+                break;
+
+            case BCret:
+                *result = regs[i->b];
+                return 1;
+
+            case BCretvoid:
+                return 1;
+
+            case BCcall:
+            {
+                FuncDeclaration *fd = code->funcs[i->b];
+                CtfeCode *callee = ctfeCompileFunction(fd);
+                if (!callee || callee->compiling)
+                {   /* The callee was not compiled before this function was,
+                     * and turns out to be unsupported. Leave this function
+                     * to the AST interpreter from now on.
+                     */
+                    code->fd->ctfeCode = CTFECODE_FAILED;
+                    return 0;
+                }
+                if (CtfeStatus::callDepth + depth >= CTFE_RECURSION_LIMIT)
+                    return 0;
+
+                size_t calleefp = pushFrame(callee->nregs);
+                regs = stack + fp;
+                memcpy(stack + calleefp, regs + i->c, callee->nparams * sizeof(CtfeValue));
+                CtfeValue v;
+                memset(&v, 0, sizeof(v));
+                ++depth;
+                int ok = execute(callee, calleefp, &v);
+                --depth;
+                stacktop = calleefp;
+                if (!ok)
+                    return 0;
+                regs = stack + fp;
+                regs[i->a] = v;
+                break;
+            }
+
+            case BCnewarray:
+            {
+                size_t dim = R(i->b);
+                if (R(i->b) > CTFE_MAX_ARRAY)
+                    return 0;
+                CtfeArray *arr = newArray(dim, dim);
+                dinteger_t init = code->consts[i->c];
+                for (size_t j = 0; j < dim; j++)
+                    arr->data[j] = init;
+                regs[i->a].value = dim;
+                regs[i->a].arr = arr;
+                regs[i->a].lwr = 0;
+                break;
+            }
+
+            case BCconstarray:
+            {
+                CtfeArray *arr = code->arrays[i->b];
+                if (i->c)
+                {
+                    CtfeArray *copy = newArray(arr->dim, arr->dim);
+                    memcpy(copy->data, arr->data, arr->dim * sizeof(dinteger_t));
+                    arr = copy;
+                }
+                regs[i->a].value = arr->dim;
+                regs[i->a].arr = arr;
+                regs[i->a].lwr = 0;
+                break;
+            }
+
+            case BClen:
+                R(i->a) = R(i->b);
+                break;
+
+            case BCsetlen:
+            {
+                CtfeValue *v = &regs[i->a];
+                size_t len = v->value;
+                if (R(i->b) > CTFE_MAX_ARRAY)
+                    return 0;
+                size_t newlen = R(i->b);
+                if (newlen > len)
+                {
+                    dinteger_t *p = extendArray(v, newlen - len);
+                    dinteger_t init = code->consts[i->c];
+                    for (size_t j = 0; j < newlen - len; j++)
+                        p[j] = init;
+                }
+                else
+                    v->value = newlen;
+                break;
+            }
+
+            case BCindex:
+            {
+                CtfeValue *v = &regs[i->b];
+                if (R(i->c) >= v->value)
+                    return 0;
+                R(i->a) = v->arr->data[v->lwr + R(i->c)];
+                break;
+            }
+
+            case BCsetindex:
+            {
+                CtfeValue *v = &regs[i->a];
+                if (R(i->b) >= v->value)
+                    return 0;
+                v->arr->data[v->lwr + R(i->b)] = normalize(R(i->c), i->ty);
+                break;
+            }
+
+            case BCslice:
+            {
+                CtfeValue v = regs[i->b];
+                dinteger_t lwr = R(i->c);
+                dinteger_t upr = R(i->c + 1);
+                if (lwr > upr || upr > v.value)
+                    return 0;
+                regs[i->a].value = upr - lwr;
+                regs[i->a].arr = v.arr;
+                regs[i->a].lwr = v.lwr + lwr;
+                break;
+            }
+
+            case BCcat:
+            {
+                CtfeValue v1 = regs[i->b];
+                CtfeValue v2 = regs[i->c];
+                if (v1.value + v2.value > CTFE_MAX_ARRAY)
+                    return 0;
+                size_t dim = v1.value + v2.value;
+                CtfeValue *v = &regs[i->a];
+                v->value = dim;
+                v->lwr = 0;
+                if (!dim && !v1.arr && !v2.arr)
+                {
+                    v->arr = NULL;
+                    break;
+                }
+                v->arr = newArray(dim, dim);
+                if (v1.value)
+                    memcpy(v->arr->data, v1.arr->data + v1.lwr, v1.value * sizeof(dinteger_t));
+                if (v2.value)
+                    memcpy(v->arr->data + v1.value, v2.arr->data + v2.lwr, v2.value * sizeof(dinteger_t));
+                break;
+            }
+
+            case BCappend:
+            {
+                CtfeValue v2 = regs[i->b];
+                if (R(i->a) + v2.value > CTFE_MAX_ARRAY)
+                    return 0;
+                dinteger_t *p = extendArray(&regs[i->a], v2.value);
+                if (v2.value)
+                    memcpy(p, v2.arr->data + v2.lwr, v2.value * sizeof(dinteger_t));
+                break;
+            }
+
+            case BCappendelem:
+            {
+                if (R(i->a) >= CTFE_MAX_ARRAY)
+                    return 0;
+                dinteger_t e = R(i->b);
+                *extendArray(&regs[i->a], 1) = e;
+                break;
+            }
+
+            case BCarreq:
+            {
+                CtfeValue *v1 = &regs[i->b];
+                CtfeValue *v2 = &regs[i->c];
+                int eq = v1->value == v2->value;
+                for (size_t j = 0; eq && j < v1->value; j++)
+                    eq = v1->arr->data[v1->lwr + j] == v2->arr->data[v2->lwr + j];
+                R(i->a) = eq;
+                break;
+            }
+
+            default:
+                assert(0);
+        }
+    }
+
+#undef R
+#undef SR
+}
+
+/************** Interface to the AST interpreter ********************************************/
+
+/* Convert the value e computed by the AST interpreter into *v.
+ * Returns 0 if it cannot be.
+ */
+static int toValue(CtfeValue *v, Expression *e, Type *t)
+{
+    if (isScalar(t))
+    {
+        if (e->op != TOKint64)
+            return 0;
+        v->value = normalize(e->toInteger(), typeFlags(t));
+        return 1;
+    }
+
+    Type *tn = t->toBasetype()->nextOf();
+    unsigned char ty = typeFlags(tn);
+    if (e->op == TOKslice)
+        e = resolveSlice(e);
+    if (e->op == TOKnull)
+    {
+        v->value = 0;
+        v->arr = NULL;
+        return 1;
+    }
+    if (e->op == TOKstring)
+    {
+        StringExp *se = (StringExp *)e;
+        if (se->sz != tn->size() || se->len > CTFE_MAX_ARRAY)
+            return 0;
+        v->arr = newArray(se->len, se->len);
+        for (size_t i = 0; i < se->len; i++)
+            v->arr->data[i] = normalize(se->charAt(i), ty);
+        v->value = se->len;
+        return 1;
+    }
+    if (e->op == TOKarrayliteral)
+    {
+        Expressions *elements = ((ArrayLiteralExp *)e)->elements;
+        size_t dim = elements ? elements->dim : 0;
+        if (dim > CTFE_MAX_ARRAY)
+            return 0;
+        v->arr = newArray(dim, dim);
+        for (size_t i = 0; i < dim; i++)
+        {   Expression *ex = (*elements)[i];
+
+            if (ex->op != TOKint64)
+                return 0;
+            v->arr->data[i] = normalize(ex->toInteger(), ty);
+        }
+        v->value = dim;
+        return 1;
+    }
+    return 0;
+}
+
+/* Convert the value *v of type t into an Expression for the AST interpreter.
+ */
+static Expression *toExpression(Loc loc, CtfeValue *v, Type *t)
+{
+    if (isScalar(t))
+        return new IntegerExp(loc, v->value, t);
+    if (!v->arr)
+        return new NullExp(loc, t);
+
+    Type *tn = t->toBasetype()->nextOf();
+    size_t len = v->value;
+    dinteger_t *data = v->arr->data + v->lwr;
+    switch (tn->toBasetype()->ty)
+    {
+        case Tchar:
+        case Twchar:
+        case Tdchar:
+        {
+            int sz = tn->size();
+            unsigned char *s = (unsigned char *)mem.calloc(len + 1, sz);
+            for (size_t i = 0; i < len; i++)
+            {
+                switch (sz)
+                {
+                    case 1:     s[i] = data[i]; break;
+                    case 2:     ((unsigned short *)s)[i] = data[i]; break;
+                    case 4:     ((unsigned *)s)[i] = data[i]; break;
+                    default:    assert(0);
+                }
+            }
+            StringExp *se = new StringExp(loc, s, len);
+            se->type = t;
+            se->sz = sz;
+            se->committed = true;
+            se->ownedByCtfe = true;
+            return se;
+        }
+
+        default:
+        {
+            Expressions *elements = new Expressions();
+            elements->setDim(len);
+            for (size_t i = 0; i < len; i++)
+                (*elements)[i] = new IntegerExp(loc, data[i], tn);
+            ArrayLiteralExp *ae = new ArrayLiteralExp(loc, elements);
+            ae->type = t;
+            ae->ownedByCtfe = true;
+            return ae;
+        }
+    }
+}
+
+/*************************************
+ * Attempt to run fd with the bytecode interpreter, given the arguments
+ * already evaluated by the AST interpreter.
+ * Returns:
+ *      result expression, or EXP_VOID_INTERPRET if fd returned void
+ *      NULL    fd must be run by the AST interpreter
+ */
+
+Expression *ctfeRunBytecode(Loc loc, FuncDeclaration *fd, Expressions *eargs)
+{
+    CtfeCode *code = ctfeCompileFunction(fd);
+    /* Arrays passed in are copies, so changes to their elements would not
+     * be seen by the caller.
+     */
+    if (!code || code->compiling || code->mutableArrayArgs)
+        return NULL;
+    if (CtfeStatus::callDepth + depth >= CTFE_RECURSION_LIMIT)
+        return NULL;
+
+    size_t oldtop = stacktop;
+    size_t fp = pushFrame(code->nregs);
+    for (int i = 0; i < code->nparams; i++)
+    {
+        if (!toValue(&stack[fp + i], (*eargs)[i], (*fd->parameters)[i]->type))
+        {
+            stacktop = oldtop;
+            return NULL;
+        }
+    }
+
+    CtfeValue v;
+    memset(&v, 0, sizeof(v));
+    ++depth;
+    int ok = execute(code, fp, &v);
+    --depth;
+    stacktop = oldtop;
+    if (!ok)
+    {   /* The AST interpreter repeats the call, and with it every call
+         * it makes to fd again. Don't retry those, or a deep recursion
+         * would be run over and over.
+         */
+        fd->ctfeCode = CTFECODE_FAILED;
+        return NULL;
+    }
+    ++CtfeStatus::numBytecodeCalls;
+
+    Type *tret = ((TypeFunction *)fd->type->toBasetype())->next;
+    if (isVoid(tret))
+        return EXP_VOID_INTERPRET;
+    return toExpression(loc, &v, tret);
+}
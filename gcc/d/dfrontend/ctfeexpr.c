@@ -21,6 +21,7 @@
 #include "id.h"
 #include "template.h"
 #include "ctfe.h"
+#include "utf.h"
 
 #ifdef IN_GCC
 #include "d-dmd-gcc.h"
@@ -1540,11 +1541,280 @@ Expression *ctfeCat(Type *type, Expression *e1, Expression *e2)
     return Cat(type, e1, e2);
 }
 
+/******** Appending to strings in place ***************************/
+
+/* Building a string with ~= in CTFE used to copy it on every append.
+ * Now the first append copies it into a buffer with room to spare, and
+ * later ones write into that room. Each append makes a new StringExp
+ * for the longer string, so anything still referring to the shorter one
+ * sees no change. The buffer records how much of it is in use, and only
+ * the StringExp that ends there may append in place; any other copies
+ * the string first, like the D runtime does for arrays.
+ *
+ * Array literals of other types still copy, as their elements arrays
+ * cannot share storage.
+ */
+
+struct CtfeStringBuffer
+{
+    void *data;                 // the StringExp::string using it
+    size_t used;                // chars in use
+    size_t allocdim;            // chars allocated, not counting the 0
+};
+
+/// Returns e1 ~= e2, appending in place to a string owned by CTFE.
+Expression *ctfeCatAssign(Type *type, Expression *e1, Expression *e2)
+{
+    if (e1->op != TOKstring || !((StringExp *)e1)->ownedByCtfe)
+        return ctfeCat(type, e1, e2);
+
+    StringExp *es1 = (StringExp *)e1;
+    size_t sz = es1->sz;
+    void *s2;
+    size_t len2;
+    unsigned char c[4 * 4];     // the encoding of a character
+
+    if (e2->op == TOKstring && ((StringExp *)e2)->sz == sz)
+    {
+        s2 = ((StringExp *)e2)->string;
+        len2 = ((StringExp *)e2)->len;
+    }
+    else if (e2->op == TOKint64 && e2->type->toBasetype()->isintegral())
+    {
+        dinteger_t v = e2->toInteger();
+        s2 = c;
+        if (sz == e2->type->toBasetype()->size())
+        {   memcpy(c, &v, sz);
+            len2 = 1;
+        }
+        else
+        {   utf_encode(sz, c, v);
+            len2 = utf_codeLength(sz, v);
+        }
+    }
+    else
+        return ctfeCat(type, e1, e2);
+
+    size_t len = es1->len + len2;
+    CtfeStringBuffer *b = es1->ctfeBuffer;
+    if (!b || b->data != es1->string || b->used != es1->len || len > b->allocdim)
+    {
+        b = new CtfeStringBuffer;
+        b->allocdim = len * 2 + 16;
+        b->data = mem.malloc((b->allocdim + 1) * sz);
+        memcpy(b->data, es1->string, es1->len * sz);
+        ++CtfeStatus::numArrayAllocs;
+    }
+    memcpy((unsigned char *)b->data + es1->len * sz, s2, len2 * sz);
+
+    // Add terminating 0
+    memset((unsigned char *)b->data + len * sz, 0, sz);
+    b->used = len;
+
+    StringExp *es = new StringExp(es1->loc, b->data, len);
+    es->sz = sz;
+    es->committed = es1->committed;
+    es->type = type;
+    es->ownedByCtfe = true;
+    es->ctfeBuffer = b;
+    return es;
+}
+
+/// se is leaving CTFE. Stop appending to its buffer, and make sure the
+/// string is still followed by a 0, which a longer string sharing the
+/// buffer may have overwritten.
+void freezeCtfeString(StringExp *se)
+{
+    CtfeStringBuffer *b = se->ctfeBuffer;
+    if (!b)
+        return;
+    se->ctfeBuffer = NULL;
+    if (b->data == se->string && b->used == se->len)
+        return;
+
+    void *s = mem.malloc((se->len + 1) * se->sz);
+    memcpy(s, se->string, se->len * se->sz);
+    memset((unsigned char *)s + se->len * se->sz, 0, se->sz);
+    se->string = s;
+}
+
+/******** Hashed lookup in associative array literals ***************/
+
+/* In CTFE an associative array is an AssocArrayLiteralExp, and a key is
+ * found by comparing it with each of the keys in turn. Once there are
+ * more than a few, a hash table of the positions of the keys is kept
+ * next to the literal. It is only an index: the keys and values arrays
+ * stay the way they are, so nothing needs converting when the array
+ * leaves CTFE.
+ *
+ * Keys arrays can be shared by several literals and are appended to in
+ * place, so a table remembers which array it is for and how many of its
+ * keys it holds. Removing keys from any array makes every table stale.
+ */
+
+#define AAINDEX_MIN     8       // search arrays with fewer keys directly
+
+struct CtfeAAIndex
+{
+    Expressions *keys;          // the keys array indexed
+    size_t dim;                 // keys[0 .. dim] are in the table
+    unsigned generation;        // aaIndexGeneration when built
+    size_t tabledim;            // a power of 2
+    size_t *table;              // 1 + index into keys, 0 if empty
+    hash_t *hashes;             // ctfeHash() of the key in each slot
+};
+
+static unsigned aaIndexGeneration;
+
+/* Hash a CTFE value, so that values ctfeEqual() finds to be equal have
+ * the same hash. It follows the cases of ctfeRawCmp().
+ */
+static hash_t ctfeHash(Expression *e)
+{
+    if (e->op == TOKclassreference)
+        return (hash_t)((ClassReferenceExp *)e)->value;
+    if (e->op == TOKnull || e->type->ty == Tpointer)
+        return 0;
+    if (isArray(e))
+    {
+        uinteger_t len = resolveArrayLength(e);
+        uinteger_t lo = 0;
+        if (e->op == TOKslice)
+        {   lo = ((SliceExp *)e)->lwr->toInteger();
+            e = ((SliceExp *)e)->e1;
+        }
+        hash_t h = 0;
+        for (uinteger_t i = 0; i < len; i++)
+        {
+            if (e->op == TOKstring)
+                h = h * 37 + ((StringExp *)e)->charAt(lo + i);
+            else
+                h = h * 37 + ctfeHash((*((ArrayLiteralExp *)e)->elements)[lo + i]);
+        }
+        return h;
+    }
+    if (e->type->isintegral())
+        return (hash_t)e->toInteger();
+    if (e->op == TOKstructliteral)
+    {   StructLiteralExp *se = (StructLiteralExp *)e;
+        hash_t h = (hash_t)se->sd;
+        if (se->elements)
+        {
+            for (size_t i = 0; i < se->elements->dim; i++)
+            {   Expression *ee = (*se->elements)[i];
+                if (ee)
+                    h = h * 37 + ctfeHash(ee);
+            }
+        }
+        return h;
+    }
+    // Floating point keys are left to ctfeEqual(), as 0.0 == -0.0
+    return 0;
+}
+
+static size_t aaIndexSlot(CtfeAAIndex *x, hash_t h)
+{
+    return (h ^ (h >> 15) ^ (h >> 31)) & (x->tabledim - 1);
+}
+
+static void aaIndexGrow(CtfeAAIndex *x)
+{
+    size_t *oldtable = x->table;
+    hash_t *oldhashes = x->hashes;
+    size_t olddim = x->tabledim;
+
+    x->tabledim = olddim ? olddim * 2 : 32;
+    x->table = (size_t *)mem.calloc(x->tabledim, sizeof(size_t));
+    x->hashes = (hash_t *)mem.malloc(x->tabledim * sizeof(hash_t));
+    for (size_t i = 0; i < olddim; i++)
+    {
+        if (oldtable[i])
+        {   size_t j = aaIndexSlot(x, oldhashes[i]);
+            while (x->table[j])
+                j = (j + 1) & (x->tabledim - 1);
+            x->table[j] = oldtable[i];
+            x->hashes[j] = oldhashes[i];
+        }
+    }
+    mem.free(oldtable);
+    mem.free(oldhashes);
+}
+
+/* Return 1 + the index of the last key equal to ekey, or 0 if there is
+ * none.
+ */
+static size_t aaIndexFind(Loc loc, CtfeAAIndex *x, Expression *ekey, hash_t h)
+{
+    for (size_t j = aaIndexSlot(x, h); x->table[j]; j = (j + 1) & (x->tabledim - 1))
+    {
+        if (x->hashes[j] == h &&
+            ctfeEqual(loc, TOKequal, (*x->keys)[x->table[j] - 1], ekey))
+            return x->table[j];
+    }
+    return 0;
+}
+
+static void aaIndexInsert(Loc loc, CtfeAAIndex *x, size_t i)
+{
+    Expression *ekey = (*x->keys)[i];
+    hash_t h = ctfeHash(ekey);
+    size_t j = aaIndexSlot(x, h);
+
+    for (; x->table[j]; j = (j + 1) & (x->tabledim - 1))
+    {
+        if (x->hashes[j] == h &&
+            ctfeEqual(loc, TOKequal, (*x->keys)[x->table[j] - 1], ekey))
+            break;      // a later duplicate hides the earlier key
+    }
+    x->table[j] = i + 1;
+    x->hashes[j] = h;
+}
+
+/* Get the up to date index of ae, or NULL if it is small enough to
+ * search directly.
+ */
+static CtfeAAIndex *aaIndex(Loc loc, AssocArrayLiteralExp *ae)
+{
+    Expressions *keys = ae->keys;
+    if (keys->dim < AAINDEX_MIN)
+        return NULL;
+
+    CtfeAAIndex *x = ae->ctfeIndex;
+    if (!x || x->keys != keys || x->generation != aaIndexGeneration ||
+        x->dim > keys->dim)
+    {
+        x = (CtfeAAIndex *)mem.calloc(1, sizeof(CtfeAAIndex));
+        x->keys = keys;
+        x->generation = aaIndexGeneration;
+        ae->ctfeIndex = x;
+    }
+    for (; x->dim < keys->dim; x->dim++)
+    {
+        if ((x->dim + 1) * 2 > x->tabledim)
+            aaIndexGrow(x);
+        aaIndexInsert(loc, x, x->dim);
+    }
+    return x;
+}
+
+/* Keys have been removed from an AA literal, so no index can be trusted.
+ */
+void aaKeysRemoved()
+{
+    aaIndexGeneration++;
+}
+
 /*  Given an AA literal 'ae', and a key 'e2':
  *  Return ae[e2] if present, or NULL if not found.
  */
 Expression *findKeyInAA(Loc loc, AssocArrayLiteralExp *ae, Expression *e2)
 {
+    CtfeAAIndex *x = aaIndex(loc, ae);
+    if (x)
+    {   size_t i = aaIndexFind(loc, x, e2, ctfeHash(e2));
+        return i ? (*ae->values)[i - 1] : NULL;
+    }
+
     /* Search the keys backwards, in case there are duplicate keys
      */
     for (size_t i = ae->keys->dim; i;)
@@ -1744,6 +2014,17 @@ Expression *assignAssocArrayElement(Loc loc, AssocArrayLiteralExp *aae,
      */
     Expressions *keysx = aae->keys;
     Expressions *valuesx = aae->values;
+    CtfeAAIndex *x = aaIndex(loc, aae);
+    if (x)
+    {   size_t i = aaIndexFind(loc, x, index, ctfeHash(index));
+        if (i)
+            (*valuesx)[i - 1] = newval;
+        else
+        {   valuesx->push(newval);
+            keysx->push(index);
+        }
+        return newval;
+    }
     int updated = 0;
     for (size_t j = valuesx->dim; j; )
     {   j--;
@@ -2093,3 +2374,222 @@ Expression *TypeStruct::voidInitLiteral(VarDeclaration *var)
     se->ownedByCtfe = true;
     return se;
 }
+
+/******** Memoization of pure function calls ***************/
+
+/* Template instances often call the same compile time helper with the
+ * same arguments. A call to a strongly pure function, whose arguments
+ * are all plain values, always gives the same result, so it is kept in
+ * a table keyed by the function and the values of its arguments, and
+ * later calls take a copy of it.
+ *
+ * A plain value is an integer, a string, null, or an array or struct
+ * literal of plain values. Floating point arguments are not memoized,
+ * as their equality is not identity; pointers and class references may
+ * refer into the CTFE stack.
+ */
+
+struct CtfeMemoEntry
+{
+    FuncDeclaration *fd;
+    hash_t hash;
+    Expressions *args;          // copies of the arguments
+    Expression *result;         // NULL until the call has returned
+    CtfeMemoEntry *next;        // next in hash chain
+};
+
+static CtfeMemoEntry **memotab;
+static size_t memotabdim;       // a power of 2
+static size_t memocount;
+
+static bool isMemoValue(Expression *e, bool allowFloat)
+{
+    switch (e->op)
+    {
+        case TOKint64:
+        case TOKstring:
+        case TOKnull:
+            return true;
+
+        case TOKfloat64:
+        case TOKcomplex80:
+            return allowFloat;
+
+        case TOKarrayliteral:
+        {   Expressions *elems = ((ArrayLiteralExp *)e)->elements;
+            for (size_t i = 0; i < elems->dim; i++)
+            {
+                if (!isMemoValue((*elems)[i], allowFloat))
+                    return false;
+            }
+            return true;
+        }
+
+        case TOKstructliteral:
+        {   StructLiteralExp *se = (StructLiteralExp *)e;
+            if (!se->elements)
+                return true;
+            for (size_t i = 0; i < se->elements->dim; i++)
+            {   Expression *ee = (*se->elements)[i];
+                if (ee && !isMemoValue(ee, allowFloat))
+                    return false;
+            }
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+/* Unlike ctfeEqual(), null is not the same as an empty array here, as
+ * the function can tell them apart.
+ */
+static bool memoEqual(Expression *e1, Expression *e2)
+{
+    if (e1->op != e2->op)
+        return false;
+    switch (e1->op)
+    {
+        case TOKint64:
+            return e1->toInteger() == e2->toInteger();
+
+        case TOKnull:
+            return true;
+
+        case TOKstring:
+        {   StringExp *se1 = (StringExp *)e1;
+            StringExp *se2 = (StringExp *)e2;
+            return se1->sz == se2->sz && se1->len == se2->len &&
+                memcmp(se1->string, se2->string, se1->len * se1->sz) == 0;
+        }
+
+        case TOKarrayliteral:
+        {   Expressions *elems1 = ((ArrayLiteralExp *)e1)->elements;
+            Expressions *elems2 = ((ArrayLiteralExp *)e2)->elements;
+            if (elems1->dim != elems2->dim)
+                return false;
+            for (size_t i = 0; i < elems1->dim; i++)
+            {
+                if (!memoEqual((*elems1)[i], (*elems2)[i]))
+                    return false;
+            }
+            return true;
+        }
+
+        case TOKstructliteral:
+        {   StructLiteralExp *se1 = (StructLiteralExp *)e1;
+            StructLiteralExp *se2 = (StructLiteralExp *)e2;
+            size_t dim1 = se1->elements ? se1->elements->dim : 0;
+            size_t dim2 = se2->elements ? se2->elements->dim : 0;
+            if (se1->sd != se2->sd || dim1 != dim2)
+                return false;
+            for (size_t i = 0; i < dim1; i++)
+            {   Expression *ee1 = (*se1->elements)[i];
+                Expression *ee2 = (*se2->elements)[i];
+                if (ee1 != ee2 && (!ee1 || !ee2 || !memoEqual(ee1, ee2)))
+                    return false;
+            }
+            return true;
+        }
+
+        default:
+            assert(0);
+            return false;
+    }
+}
+
+static void memoGrow()
+{
+    size_t newdim = memotabdim ? memotabdim * 2 : 256;
+    CtfeMemoEntry **newtab = (CtfeMemoEntry **)mem.calloc(newdim, sizeof(CtfeMemoEntry *));
+    for (size_t i = 0; i < memotabdim; i++)
+    {
+        for (CtfeMemoEntry *me = memotab[i]; me; )
+        {   CtfeMemoEntry *next = me->next;
+            size_t j = me->hash & (newdim - 1);
+            me->next = newtab[j];
+            newtab[j] = me;
+            me = next;
+        }
+    }
+    mem.free(memotab);
+    memotab = newtab;
+    memotabdim = newdim;
+}
+
+/* Look up the call fd(eargs) in the memo table, and set *presult to a
+ * copy of its result if it is there.
+ * Returns:
+ *      NULL if the call cannot be memoized, or was found
+ *      otherwise a new entry, to pass to ctfeMemoSave() with the result
+ *      of the call
+ */
+CtfeMemoEntry *ctfeMemoFind(FuncDeclaration *fd, Expression *thisarg, Expressions *eargs,
+        Expression **presult)
+{
+    *presult = NULL;
+    if (thisarg || fd->isPureBypassingInference() != PUREstrong)
+        return NULL;
+
+    TypeFunction *tf = (TypeFunction *)fd->type->toBasetype();
+    if (tf->varargs || tf->isref)
+        return NULL;
+
+    hash_t hash = (hash_t)fd;
+    for (size_t i = 0; i < eargs->dim; i++)
+    {   Parameter *arg = Parameter::getNth(tf->parameters, i);
+        Expression *earg = (*eargs)[i];
+        if (arg->storageClass & (STCout | STCref | STClazy) ||
+            !isMemoValue(earg, false))
+            return NULL;
+        hash = hash * 37 + ctfeHash(earg);
+    }
+
+    if (memotabdim)
+    {
+        for (CtfeMemoEntry *me = memotab[hash & (memotabdim - 1)]; me; me = me->next)
+        {
+            if (me->hash != hash || me->fd != fd || me->args->dim != eargs->dim)
+                continue;
+            size_t i = 0;
+            while (i < eargs->dim && memoEqual((*me->args)[i], (*eargs)[i]))
+                i++;
+            if (i == eargs->dim)
+            {
+                ++CtfeStatus::numMemoHits;
+                *presult = copyLiteral(me->result);
+                return NULL;
+            }
+        }
+    }
+    ++CtfeStatus::numMemoMisses;
+
+    // The function may change its arguments, so keep them as they are now
+    CtfeMemoEntry *me = new CtfeMemoEntry;
+    me->fd = fd;
+    me->hash = hash;
+    me->args = new Expressions();
+    me->args->setDim(eargs->dim);
+    for (size_t i = 0; i < eargs->dim; i++)
+        (*me->args)[i] = copyLiteral((*eargs)[i]);
+    me->result = NULL;
+    me->next = NULL;
+    return me;
+}
+
+/* The call for entry me returned e; remember it if it is a plain value.
+ */
+void ctfeMemoSave(CtfeMemoEntry *me, Expression *e)
+{
+    if (!isMemoValue(e, true))
+        return;
+
+    if (memocount >= memotabdim)
+        memoGrow();
+    me->result = copyLiteral(e);
+    size_t j = me->hash & (memotabdim - 1);
+    me->next = memotab[j];
+    memotab[j] = me;
+    memocount++;
+}
@@ -1545,6 +1545,11 @@ Lnomatch:
                 ei->exp = ei->exp->semantic(sc);
                 canassign--;
                 ei->exp->optimize(WANTvalue);
+
+                // A delegate to a nested function stored in a local may not escape
+                if (t->ty == Tdelegate && !isScope() && !(storage_class & (STCref | STCout)) &&
+                    (ei->exp->op == TOKconstruct || ei->exp->op == TOKblit || ei->exp->op == TOKassign))
+                    noteDelegateUse(((AssignExp *)ei->exp)->e2, NULL, 0, this);
             }
             else
             {
@@ -26,6 +26,7 @@ struct Initializer;
 struct Module;
 struct InlineScanState;
 struct ForeachStatement;
+struct CtfeCode;
 struct FuncDeclaration;
 struct ExpInitializer;
 struct StructDeclaration;
@@ -584,6 +585,8 @@ struct FuncDeclaration : Declaration
     Declaration *overnext;              // next in overload list
     Loc endloc;                         // location of closing curly bracket
     int vtblIndex;                      // for member functions, index into vtbl[]
+    bool overridden;                    // !=0 if a function of a derived class
+                                        // overrides this one in its vtbl[]
     bool naked;                         // !=0 if naked
     ILS inlineStatusStmt;
     ILS inlineStatusExp;
@@ -613,6 +616,9 @@ struct FuncDeclaration : Declaration
 
     ReturnStatements *returns;
 
+    CtfeCode *ctfeCode;                 // bytecode for CTFE, CTFECODE_FAILED if
+                                        // it cannot be compiled or a run failed
+
 #if DMDV2
     enum BUILTIN builtin;               // set if this is a known, builtin
                                         // function we can evaluate at compile
@@ -620,6 +626,8 @@ struct FuncDeclaration : Declaration
 
     int tookAddressOf;                  // set if someone took the address of
                                         // this function
+    Array delegateUses;                 // DelegateUse's which may not let the
+                                        // address escape, see escape.c
     bool requiresClosure;               // this function needs a closure
     VarDeclarations closureVars;        // local variables in this function
                                         // which are referenced by nested
@@ -697,6 +705,8 @@ struct FuncDeclaration : Declaration
     FuncDeclaration *isUnique();
     void checkNestedReference(Scope *sc, Loc loc);
     int needsClosure();
+    int escapingAddresses();
+    int parameterEscapes(size_t i);
     int hasNestedFrameRefs();
     void buildResultVar();
     Statement *mergeFrequire(Statement *);
@@ -723,7 +733,9 @@ FuncDeclaration *resolveFuncCall(Scope *sc, Loc loc, Dsymbol *s,
         Expression *ethis,
         Expressions *arguments,
         int flags);
+void noteDelegateUse(Expression *e, FuncDeclaration *callee, size_t i, VarDeclaration *var);
 #endif
+char *shortMangle(char *p);
 
 struct FuncAliasDeclaration : FuncDeclaration
 {
@@ -0,0 +1,480 @@
+// Compiler implementation of the D programming language
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+#include <stdio.h>
+#include <assert.h>
+
+#include "rmem.h"
+#include "aav.h"
+
+#include "statement.h"
+#include "expression.h"
+#include "init.h"
+#include "mtype.h"
+#include "declaration.h"
+#include "template.h"
+
+/* Escape analysis for delegates to nested functions.
+ *
+ * Taking the address of a nested function counts in its tookAddressOf,
+ * and needsClosure() puts the frame of a function on the heap if a nested
+ * function using it has had its address taken. Passing a delegate to a
+ * scope parameter, or initializing a scope variable with one, already
+ * does not count.
+ *
+ * Here two more cases are looked at, once semantic3() has been run on
+ * everything: a delegate passed to a parameter that the body of the called
+ * function never lets escape, and a delegate stored in a local variable
+ * that is only ever called, compared, or passed on in the same way.
+ * Such uses are recorded as DelegateUses while the call or declaration
+ * goes through semantic(), and escapingAddresses() subtracts what each
+ * of the ones which turn out not to escape added to tookAddressOf.
+ *
+ * A variable escapes unless every reference to it in the body of its
+ * function is one of:
+ *      v(args)                 a call
+ *      v = e                   an assignment to it
+ *      v is e, v == e          a comparison
+ *      cast(bool)v             a test
+ *      f(v)                    an argument to a parameter of f that does
+ *                              not escape
+ * and it is not referenced by any nested function. Anything the scan
+ * does not understand counts as an escape.
+ */
+
+struct DelegateUse
+{
+    Expression *exp;            // the delegate
+    int counted;                // what exp added to tookAddressOf
+    FuncDeclaration *callee;    // passed to this function
+    size_t param;               // as this parameter
+    VarDeclaration *var;        // or, stored in this variable
+};
+
+struct EscapeState
+{
+    VarDeclaration *v;
+    int uses;                   // references to v
+    int harmless;               // references to v that do not let it escape
+};
+
+static int delegateEscapes(VarDeclaration *v);
+
+/********************************************
+ * Return the nested function e is a delegate to, or NULL.
+ * Set *counted to what e added to its tookAddressOf.
+ */
+
+static FuncDeclaration *delegateTarget(Expression *e, int *counted)
+{
+    FuncDeclaration *f = NULL;
+    if (e->op == TOKfunction)
+    {   f = ((FuncExp *)e)->fd;
+        *counted = ((FuncExp *)e)->tookAddress;
+    }
+    else if (e->op == TOKdelegate)
+    {   f = ((DelegateExp *)e)->func;
+        *counted = ((DelegateExp *)e)->tookAddress;
+    }
+
+    return (f && f->isNested()) ? f : NULL;
+}
+
+/********************************************
+ * Record that the delegate e is passed to parameter i of callee,
+ * or that it initializes var.
+ */
+
+void noteDelegateUse(Expression *e, FuncDeclaration *callee, size_t i, VarDeclaration *var)
+{
+    if (e->op == TOKcast)
+        e = ((CastExp *)e)->e1;
+
+    int counted = 0;
+    FuncDeclaration *f = delegateTarget(e, &counted);
+    if (!f || counted <= 0)
+        return;
+
+    // The same expression may go through semantic more than once.
+    for (size_t j = 0; j < f->delegateUses.dim; j++)
+    {
+        if (((DelegateUse *)f->delegateUses.data[j])->exp == e)
+            return;
+    }
+
+    DelegateUse *du = new DelegateUse();
+    du->exp = e;
+    du->counted = counted;
+    du->callee = callee;
+    du->param = i;
+    du->var = var;
+    f->delegateUses.push(du);
+}
+
+/********************************************
+ * Return the number of times the address of this function was taken
+ * in a way that lets it escape.
+ */
+
+int FuncDeclaration::escapingAddresses()
+{
+    int n = tookAddressOf;
+
+    for (size_t i = 0; n > 0 && i < delegateUses.dim; i++)
+    {
+        DelegateUse *du = (DelegateUse *)delegateUses.data[i];
+        if (du->counted <= n &&
+            (du->var ? !delegateEscapes(du->var) : !du->callee->parameterEscapes(du->param)))
+            n -= du->counted;
+    }
+    return n;
+}
+
+/********************************************
+ * Return !=0 if the value passed to parameter i of this function
+ * may outlive the call.
+ */
+
+int FuncDeclaration::parameterEscapes(size_t i)
+{
+    TypeFunction *tf = (TypeFunction *)type;
+    assert(tf->ty == Tfunction);
+
+    if (i >= Parameter::dim(tf->parameters))
+        return 1;               // a variadic argument
+    Parameter *p = Parameter::getNth(tf->parameters, i);
+    if (!tf->parameterEscapes(p))
+        return 0;
+    if (p->storageClass & (STCref | STCout))
+        return 1;
+
+    // Only a body we have seen can be looked at, and only if
+    // it cannot be overridden by another one.
+    if (!fbody || semanticRun < PASSsemantic3done ||
+        !parameters || i >= parameters->dim ||
+        (isVirtual() && !isFinal()))
+        return 1;
+
+    return delegateEscapes((*parameters)[i]);
+}
+
+/********************************************
+ * Count the references to es->v in e.
+ */
+
+static bool isVar(Expression *e, VarDeclaration *v)
+{
+    if (e->op == TOKcast && e->type->toBasetype()->ty == Tdelegate)
+        e = ((CastExp *)e)->e1;
+    return e->op == TOKvar && ((VarExp *)e)->var == v;
+}
+
+static int escapeExp(Expression *e, void *param);
+
+static int scanDeclaration(Dsymbol *s, EscapeState *es)
+{
+    VarDeclaration *vd = s->isVarDeclaration();
+    if (vd && vd->init && !vd->init->isVoidInitializer())
+    {
+        ExpInitializer *ei = vd->init->isExpInitializer();
+        if (!ei)
+            return 1;           // can't tell what is in it
+        return ei->exp->apply(&escapeExp, es);
+    }
+
+    TupleDeclaration *td = s->isTupleDeclaration();
+    if (td && td->objects)
+    {
+        for (size_t i = 0; i < td->objects->dim; i++)
+        {
+            Dsymbol *sx = isDsymbol((*td->objects)[i]);
+            if (sx && scanDeclaration(sx, es))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+static int escapeExp(Expression *e, void *param)
+{
+    EscapeState *es = (EscapeState *)param;
+    VarDeclaration *v = es->v;
+
+    switch (e->op)
+    {
+        case TOKvar:
+            if (((VarExp *)e)->var == v)
+                es->uses++;
+            break;
+
+        case TOKsymoff:
+            if (((SymOffExp *)e)->var == v)
+                return 1;       // its address is taken
+            break;
+
+        case TOKdeclaration:
+            return scanDeclaration(((DeclarationExp *)e)->declaration, es);
+
+        case TOKcall:
+        {   CallExp *ce = (CallExp *)e;
+            if (isVar(ce->e1, v))
+                es->harmless++;
+            if (!ce->arguments)
+                break;
+
+            Type *t = ce->e1->type->toBasetype();
+            if (t->ty == Tdelegate || t->ty == Tpointer)
+                t = t->nextOf()->toBasetype();
+            if (t->ty != Tfunction)
+                break;
+            TypeFunction *tf = (TypeFunction *)t;
+
+            for (size_t i = 0; i < ce->arguments->dim; i++)
+            {
+                if (!isVar((*ce->arguments)[i], v))
+                    continue;
+                if (i >= Parameter::dim(tf->parameters))
+                    continue;
+                Parameter *p = Parameter::getNth(tf->parameters, i);
+                if (!tf->parameterEscapes(p) ||
+                    (ce->f && !ce->f->parameterEscapes(i)))
+                    es->harmless++;
+            }
+            break;
+        }
+
+        case TOKassign:
+        case TOKconstruct:
+        case TOKblit:
+            if (isVar(((AssignExp *)e)->e1, v))
+                es->harmless++;
+            break;
+
+        case TOKidentity:
+        case TOKnotidentity:
+        case TOKequal:
+        case TOKnotequal:
+        {   BinExp *be = (BinExp *)e;
+            if (isVar(be->e1, v))
+                es->harmless++;
+            if (isVar(be->e2, v))
+                es->harmless++;
+            break;
+        }
+
+        case TOKcast:
+            if (e->type->toBasetype()->ty == Tbool && isVar(((CastExp *)e)->e1, v))
+                es->harmless++;
+            break;
+
+        default:
+            break;
+    }
+    return 0;
+}
+
+static int scanExp(Expression *e, EscapeState *es)
+{
+    return e ? e->apply(&escapeExp, es) : 0;
+}
+
+static int scanStatement(Statement *s, EscapeState *es)
+{
+    return s ? s->escapeScan(es) : 0;
+}
+
+/********************************************
+ * Return !=0 if v, a parameter or local variable, may outlive the call
+ * of its function.
+ */
+
+static AA *escapetab;
+
+enum
+{
+    ESCAPEinprocess = 1,
+    ESCAPEno,
+    ESCAPEyes
+};
+
+static int delegateEscapes(VarDeclaration *v)
+{
+    Value *pv = _aaGet(&escapetab, v);
+    if (*pv)
+        return *pv != (Value)ESCAPEno;  // still working on it counts as yes
+
+    *pv = (Value)ESCAPEinprocess;
+    int result = 1;
+
+    FuncDeclaration *fd = v->toParent2()->isFuncDeclaration();
+    if (fd && fd->fbody && fd->semanticRun >= PASSsemantic3done && !v->nestedrefs.dim &&
+        !(v->storage_class & (STCref | STCout | STClazy | STCstatic | STCtls | STCgshared | STCmanifest | STCextern)))
+    {
+        EscapeState es;
+        es.v = v;
+        es.uses = 0;
+        es.harmless = 0;
+        if (!fd->fbody->escapeScan(&es))
+            result = es.uses > es.harmless;
+    }
+
+    *pv = (Value)(result ? ESCAPEyes : ESCAPEno);
+    return result;
+}
+
+/********************************************
+ * Scan the expressions of the statement for references to es->v.
+ * Returns !=0 if the statement could not be scanned.
+ */
+
+int Statement::escapeScan(EscapeState *es)
+{
+    return 1;
+}
+
+int ExpStatement::escapeScan(EscapeState *es)
+{
+    return scanExp(exp, es);
+}
+
+int CompoundStatement::escapeScan(EscapeState *es)
+{
+    for (size_t i = 0; i < statements->dim; i++)
+    {
+        if (scanStatement((*statements)[i], es))
+            return 1;
+    }
+    return 0;
+}
+
+int UnrolledLoopStatement::escapeScan(EscapeState *es)
+{
+    for (size_t i = 0; i < statements->dim; i++)
+    {
+        if (scanStatement((*statements)[i], es))
+            return 1;
+    }
+    return 0;
+}
+
+int ScopeStatement::escapeScan(EscapeState *es)
+{
+    return scanStatement(statement, es);
+}
+
+int DoStatement::escapeScan(EscapeState *es)
+{
+    return scanStatement(body, es) || scanExp(condition, es);
+}
+
+int ForStatement::escapeScan(EscapeState *es)
+{
+    return scanStatement(init, es) ||
+           scanExp(condition, es) ||
+           scanExp(increment, es) ||
+           scanStatement(body, es);
+}
+
+int IfStatement::escapeScan(EscapeState *es)
+{
+    return scanExp(condition, es) ||
+           scanStatement(ifbody, es) ||
+           scanStatement(elsebody, es);
+}
+
+int SwitchStatement::escapeScan(EscapeState *es)
+{
+    return scanExp(condition, es) || scanStatement(body, es);
+}
+
+int CaseStatement::escapeScan(EscapeState *es)
+{
+    return scanStatement(statement, es);
+}
+
+int DefaultStatement::escapeScan(EscapeState *es)
+{
+    return scanStatement(statement, es);
+}
+
+int GotoDefaultStatement::escapeScan(EscapeState *es)
+{
+    return 0;
+}
+
+int GotoCaseStatement::escapeScan(EscapeState *es)
+{
+    return 0;
+}
+
+int SwitchErrorStatement::escapeScan(EscapeState *es)
+{
+    return 0;
+}
+
+int ReturnStatement::escapeScan(EscapeState *es)
+{
+    return scanExp(exp, es);
+}
+
+int BreakStatement::escapeScan(EscapeState *es)
+{
+    return 0;
+}
+
+int ContinueStatement::escapeScan(EscapeState *es)
+{
+    return 0;
+}
+
+int SynchronizedStatement::escapeScan(EscapeState *es)
+{
+    return scanExp(exp, es) || scanStatement(body, es);
+}
+
+int WithStatement::escapeScan(EscapeState *es)
+{
+    return scanExp(exp, es) || scanStatement(body, es);
+}
+
+int TryCatchStatement::escapeScan(EscapeState *es)
+{
+    if (scanStatement(body, es))
+        return 1;
+    for (size_t i = 0; i < catches->dim; i++)
+    {
+        if (scanStatement((*catches)[i]->handler, es))
+            return 1;
+    }
+    return 0;
+}
+
+int TryFinallyStatement::escapeScan(EscapeState *es)
+{
+    return scanStatement(body, es) || scanStatement(finalbody, es);
+}
+
+int ThrowStatement::escapeScan(EscapeState *es)
+{
+    return scanExp(exp, es);
+}
+
+int GotoStatement::escapeScan(EscapeState *es)
+{
+    return 0;
+}
+
+int LabelStatement::escapeScan(EscapeState *es)
+{
+    return scanStatement(statement, es);
+}
+
+int ImportStatement::escapeScan(EscapeState *es)
+{
+    return 0;
+}
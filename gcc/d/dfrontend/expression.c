@@ -1218,6 +1218,13 @@ Type *functionParameters(Loc loc, Scope *sc, TypeFunction *tf,
                     }
                 }
             }
+            else if (fd)
+            {
+                /* Whether it escapes may be found out once the body
+                 * of fd has been through semantic3.
+                 */
+                noteDelegateUse(arg, fd, i, NULL);
+            }
 #endif
             arg = arg->optimize(WANTvalue, (p->storageClass & (STCref | STCout)) != 0);
         }
@@ -3436,6 +3443,7 @@ StringExp::StringExp(Loc loc, char *string)
     this->committed = 0;
     this->postfix = 0;
     this->ownedByCtfe = false;
+    this->ctfeBuffer = NULL;
 }
 
 StringExp::StringExp(Loc loc, void *string, size_t len)
@@ -3447,6 +3455,7 @@ StringExp::StringExp(Loc loc, void *string, size_t len)
     this->committed = 0;
     this->postfix = 0;
     this->ownedByCtfe = false;
+    this->ctfeBuffer = NULL;
 }
 
 StringExp::StringExp(Loc loc, void *string, size_t len, unsigned char postfix)
@@ -3458,6 +3467,7 @@ StringExp::StringExp(Loc loc, void *string, size_t len, unsigned char postfix)
     this->committed = 0;
     this->postfix = postfix;
     this->ownedByCtfe = false;
+    this->ctfeBuffer = NULL;
 }
 
 #if 0
@@ -3950,6 +3960,7 @@ AssocArrayLiteralExp::AssocArrayLiteralExp(Loc loc,
     this->keys = keys;
     this->values = values;
     this->ownedByCtfe = false;
+    this->ctfeIndex = NULL;
 }
 
 Expression *AssocArrayLiteralExp::syntaxCopy()
@@ -5299,6 +5310,7 @@ FuncExp::FuncExp(Loc loc, FuncLiteralDeclaration *fd, TemplateDeclaration *td)
     this->fd = fd;
     this->td = td;
     tok = fd->tok;  // save original kind of function/delegate/(infer)
+    tookAddress = 0;
 }
 
 Expression *FuncExp::syntaxCopy()
@@ -5399,6 +5411,7 @@ Expression *FuncExp::semantic(Scope *sc)
             }
         }
         fd->tookAddressOf++;
+        tookAddress++;
     }
     return this;
 }
@@ -6549,7 +6562,11 @@ Expression *FileExp::semantic(Scope *sc)
         fprintf(stdmsg, "file      %s\t(%s)\n", (char *)se->string, name);
 
     {   File f(name);
+#if _WIN32
         if (f.read())
+#else
+        if (f.mmread())
+#endif
         {   error("cannot read file %s", f.toChars());
             goto Lerror;
         }
@@ -7436,6 +7453,7 @@ DelegateExp::DelegateExp(Loc loc, Expression *e, FuncDeclaration *f, int hasOver
 {
     this->func = f;
     this->hasOverloads = hasOverloads;
+    this->tookAddress = 0;
 }
 
 Expression *DelegateExp::semantic(Scope *sc)
@@ -8619,14 +8637,14 @@ Expression *AddrExp::semantic(Scope *sc)
                         if (!f->FuncDeclaration::isNested())
                         {   /* Supply a 'null' for a this pointer if no this is available
                              */
-                            Expression *e = new DelegateExp(loc, new NullExp(loc, Type::tnull), f, ve->hasOverloads);
-                            e = e->semantic(sc);
-                            return e;
+                            DelegateExp *de = new DelegateExp(loc, new NullExp(loc, Type::tnull), f, ve->hasOverloads);
+                            de->tookAddress = 1;
+                            return de->semantic(sc);
                         }
                     }
-                    Expression *e = new DelegateExp(loc, e1, f, ve->hasOverloads);
-                    e = e->semantic(sc);
-                    return e;
+                    DelegateExp *de = new DelegateExp(loc, e1, f, ve->hasOverloads);
+                    de->tookAddress = 1;
+                    return de->semantic(sc);
                 }
                 if (f->needThis() && hasThis(sc))
                 {
@@ -44,6 +44,9 @@ struct ClassDeclaration;
 struct HdrGenState;
 struct BinExp;
 struct InterState;
+struct CtfeCompiler;
+struct CtfeAAIndex;
+struct CtfeStringBuffer;
 struct Symbol;          // back end symbol
 struct OverloadSet;
 struct Initializer;
@@ -179,6 +182,7 @@ struct Expression : Object
 
     // Implementation of CTFE for this expression
     virtual Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    virtual int ctfeCompile(CtfeCompiler *cc);
 
     virtual int isConst();
     virtual int isBool(int result);
@@ -218,6 +222,7 @@ struct IntegerExp : Expression
     int equals(Object *o);
     Expression *semantic(Scope *sc);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     char *toChars();
     void dump(int indent);
     IntRange getIntRange();
@@ -371,6 +376,7 @@ struct NullExp : Expression
     MATCH implicitConvTo(Type *t);
     Expression *castTo(Scope *sc, Type *t);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     elem *toElem(IRState *irs);
     dt_t **toDt(dt_t **pdt);
 };
@@ -383,6 +389,7 @@ struct StringExp : Expression
     unsigned char committed;    // !=0 if type is committed
     unsigned char postfix;      // 'c', 'w', 'd'
     bool ownedByCtfe;   // true = created in CTFE
+    CtfeStringBuffer *ctfeBuffer;  // room to append to in CTFE
 
     StringExp(Loc loc, char *s);
     StringExp(Loc loc, void *s, size_t len);
@@ -391,6 +398,7 @@ struct StringExp : Expression
     int equals(Object *o);
     Expression *semantic(Scope *sc);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     size_t length();
     StringExp *toString();
     StringExp *toUTF8(Scope *sc);
@@ -450,6 +458,7 @@ struct ArrayLiteralExp : Expression
     void toMangleBuffer(OutBuffer *buf);
     Expression *optimize(int result, bool keepLvalue = false);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     MATCH implicitConvTo(Type *t);
     Expression *castTo(Scope *sc, Type *t);
     Expression *inferType(Type *t, int flag = 0, TemplateParameters *tparams = NULL);
@@ -464,6 +473,7 @@ struct AssocArrayLiteralExp : Expression
     Expressions *keys;
     Expressions *values;
     bool ownedByCtfe;   // true = created in CTFE
+    CtfeAAIndex *ctfeIndex;     // hash table of keys, for CTFE lookups
 
     AssocArrayLiteralExp(Loc loc, Expressions *keys, Expressions *values);
 
@@ -570,6 +580,7 @@ struct NewExp : Expression
     int apply(apply_fp_t fp, void *param);
     Expression *semantic(Scope *sc);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     Expression *optimize(int result, bool keepLvalue = false);
     MATCH implicitConvTo(Type *t);
     elem *toElem(IRState *irs);
@@ -638,6 +649,7 @@ struct VarExp : SymbolExp
     Expression *semantic(Scope *sc);
     Expression *optimize(int result, bool keepLvalue = false);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     void dump(int indent);
     char *toChars();
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
@@ -674,6 +686,7 @@ struct FuncExp : Expression
     FuncLiteralDeclaration *fd;
     TemplateDeclaration *td;
     enum TOK tok;
+    int tookAddress;            // added to fd->tookAddressOf
 
     FuncExp(Loc loc, FuncLiteralDeclaration *fd, TemplateDeclaration *td = NULL);
     Expression *syntaxCopy();
@@ -704,6 +717,7 @@ struct DeclarationExp : Expression
     Expression *syntaxCopy();
     Expression *semantic(Scope *sc);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     elem *toElem(IRState *irs);
 
@@ -742,6 +756,7 @@ struct HaltExp : Expression
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
     elem *toElem(IRState *irs);
+    int ctfeCompile(CtfeCompiler *cc);
 };
 
 struct IsExp : Expression
@@ -784,6 +799,7 @@ struct UnaExp : Expression
     Expression *inlineScan(InlineScanState *iss);
 
     virtual Expression *op_overload(Scope *sc);
+    int ctfeCompile(CtfeCompiler *cc);
 };
 
 struct BinExp : Expression
@@ -821,6 +837,7 @@ struct BinExp : Expression
     Expression *compare_overload(Scope *sc, Identifier *id);
 
     elem *toElemBin(IRState *irs, int op);
+    int ctfeCompile(CtfeCompiler *cc);
 };
 
 struct BinAssignExp : BinExp
@@ -838,6 +855,7 @@ struct BinAssignExp : BinExp
     int isLvalue();
     Expression *toLvalue(Scope *sc, Expression *ex);
     Expression *modifiableLvalue(Scope *sc, Expression *e);
+    int ctfeCompile(CtfeCompiler *cc);
 };
 
 /****************************************************************/
@@ -865,6 +883,7 @@ struct AssertExp : UnaExp
     int apply(apply_fp_t fp, void *param);
     Expression *semantic(Scope *sc);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
     Expression *doInline(InlineDoState *ids);
@@ -927,6 +946,7 @@ struct DelegateExp : UnaExp
 {
     FuncDeclaration *func;
     int hasOverloads;
+    int tookAddress;            // added to func->tookAddressOf
 
     DelegateExp(Loc loc, Expression *e, FuncDeclaration *func, int hasOverloads = 0);
     Expression *semantic(Scope *sc);
@@ -966,6 +986,7 @@ struct CallExp : UnaExp
     Expression *semantic(Scope *sc);
     Expression *optimize(int result, bool keepLvalue = false);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     void dump(int indent);
     elem *toElem(IRState *irs);
@@ -1094,6 +1115,7 @@ struct CastExp : UnaExp
     IntRange getIntRange();
     Expression *optimize(int result, bool keepLvalue = false);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     void checkEscape();
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     void buildArrayIdent(OutBuffer *buf, Expressions *arguments);
@@ -1138,6 +1160,7 @@ struct SliceExp : UnaExp
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     Expression *optimize(int result, bool keepLvalue = false);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     void dump(int indent);
     elem *toElem(IRState *irs);
     void buildArrayIdent(OutBuffer *buf, Expressions *arguments);
@@ -1153,6 +1176,7 @@ struct ArrayLengthExp : UnaExp
     Expression *semantic(Scope *sc);
     Expression *optimize(int result, bool keepLvalue = false);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     elem *toElem(IRState *irs);
 
@@ -1209,6 +1233,7 @@ struct CommaExp : BinExp
     Expression *castTo(Scope *sc, Type *t);
     Expression *optimize(int result, bool keepLvalue = false);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     elem *toElem(IRState *irs);
 };
 
@@ -1227,6 +1252,7 @@ struct IndexExp : BinExp
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     Expression *optimize(int result, bool keepLvalue = false);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     Expression *doInline(InlineDoState *ids);
 
     elem *toElem(IRState *irs);
@@ -1239,6 +1265,7 @@ struct PostExp : BinExp
     PostExp(enum TOK op, Loc loc, Expression *e);
     Expression *semantic(Scope *sc);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     Identifier *opId();    // For operator overloading
     elem *toElem(IRState *irs);
@@ -1260,6 +1287,7 @@ struct AssignExp : BinExp
     Expression *semantic(Scope *sc);
     Expression *checkToBoolean(Scope *sc);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     Identifier *opId();    // For operator overloading
     void buildArrayIdent(OutBuffer *buf, Expressions *arguments);
     Expression *buildArrayLoop(Parameters *fparams);
@@ -1362,6 +1390,7 @@ struct CatExp : BinExp
     Expression *semantic(Scope *sc);
     Expression *optimize(int result, bool keepLvalue = false);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
 
     // For operator overloading
     Identifier *opId();
@@ -1549,6 +1578,7 @@ struct OrOrExp : BinExp
     int isBit();
     Expression *optimize(int result, bool keepLvalue = false);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     elem *toElem(IRState *irs);
 };
 
@@ -1560,6 +1590,7 @@ struct AndAndExp : BinExp
     int isBit();
     Expression *optimize(int result, bool keepLvalue = false);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     elem *toElem(IRState *irs);
 };
 
@@ -1643,6 +1674,7 @@ struct CondExp : BinExp
     Expression *semantic(Scope *sc);
     Expression *optimize(int result, bool keepLvalue = false);
     Expression *interpret(InterState *istate, CtfeGoal goal = ctfeNeedRvalue);
+    int ctfeCompile(CtfeCompiler *cc);
     void checkEscape();
     void checkEscapeRef();
     int checkModifiable(Scope *sc, int flag);
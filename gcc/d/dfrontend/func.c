@@ -60,6 +60,7 @@ FuncDeclaration::FuncDeclaration(Loc loc, Loc endloc, Identifier *id, StorageCla
     labtab = NULL;
     overnext = NULL;
     vtblIndex = -1;
+    overridden = false;
     hasReturnExp = 0;
     naked = 0;
     inlineStatusExp = ILSuninitialized;
@@ -90,6 +91,7 @@ FuncDeclaration::FuncDeclaration(Loc loc, Loc endloc, Identifier *id, StorageCla
     flags = 0;
 #endif
     returns = NULL;
+    ctfeCode = NULL;
 }
 
 Dsymbol *FuncDeclaration::syntaxCopy(Dsymbol *s)
@@ -529,6 +531,7 @@ void FuncDeclaration::semantic(Scope *sc)
                 /* Remember which functions this overrides
                  */
                 foverrides.push(fdv);
+                fdv->overridden = true;
 
                 /* This works by whenever this function is called,
                  * it actually returns tintro, which gets dynamically
@@ -3303,7 +3306,7 @@ bool checkEscapingSiblings(FuncDeclaration *f, FuncDeclaration *outerFunc)
     for (int i = 0; i < f->siblingCallers.dim; ++i)
     {
         FuncDeclaration *g = f->siblingCallers[i];
-        if (g->isThis() || g->tookAddressOf)
+        if (g->isThis() || g->escapingAddresses())
         {
             markAsNeedingClosure(g, outerFunc);
             bAnyClosures = true;
@@ -3366,7 +3369,7 @@ int FuncDeclaration::needsClosure()
             for (Dsymbol *s = f; s && s != this; s = s->parent)
             {
                 FuncDeclaration *fx = s->isFuncDeclaration();
-                if (fx && (fx->isThis() || fx->tookAddressOf))
+                if (fx && (fx->isThis() || fx->escapingAddresses()))
                 {
                     //printf("\t\tfx = %s, isVirtual=%d, isThis=%p, tookAddressOf=%d\n", fx->toChars(), fx->isVirtual(), fx->isThis(), fx->tookAddressOf);
 
@@ -24,6 +24,8 @@
 #include "statement.h"
 #include "mtype.h"
 #include "scope.h"
+#include "attrib.h"
+#include "module.h"
 
 /* ========== Compute cost of inlining =============== */
 
@@ -1588,6 +1590,91 @@ Lno:
     return 0;
 }
 
+/**************************************
+ * Return !=0 if fd, a function of an imported module, is small enough
+ * for its body to be worth handing to the backend to inline.
+ * Before semantic3, hdrscan estimates the cost the way the header
+ * generator does.
+ */
+
+static int isInlineImport(FuncDeclaration *fd, int hdrscan)
+{
+    if (!fd->fbody || fd->frequire || fd->fensure ||
+        fd->isNested() ||
+        fd->isMain() ||
+        fd->isStaticCtorDeclaration() ||
+        fd->isStaticDtorDeclaration() ||
+        fd->isUnitTestDeclaration() ||
+        fd->isInvariantDeclaration() ||
+        fd->isSynchronized() ||
+        fd->isImportedSymbol() ||
+        fd->naked ||
+        (fd->isVirtual() && !fd->isFinal()))
+        return 0;
+
+    TypeFunction *tf = (TypeFunction *)fd->type;
+    if (!tf || tf->ty != Tfunction || tf->varargs == 1)
+        return 0;
+
+    if (!hdrscan && (fd->semantic3Errors || fd->hasNestedFrameRefs()))
+        return 0;
+
+    InlineCostState ics;
+    memset(&ics, 0, sizeof(ics));
+    ics.hasthis = 1;
+    ics.fd = fd;
+    ics.hdrscan = hdrscan;
+    return !tooCostly(fd->fbody->inlineCost(&ics));
+}
+
+static void inlineImports(Dsymbols *members, FuncDeclarations *fds)
+{
+    if (!members)
+        return;
+
+    for (size_t i = 0; i < members->dim; i++)
+    {   Dsymbol *s = (*members)[i];
+
+        AttribDeclaration *ad = s->isAttribDeclaration();
+        if (ad)
+        {
+            inlineImports(ad->include(NULL, NULL), fds);
+            continue;
+        }
+
+        AggregateDeclaration *agg = s->isAggregateDeclaration();
+        if (agg)
+        {
+            inlineImports(agg->members, fds);
+            continue;
+        }
+
+        FuncDeclaration *fd = s->isFuncDeclaration();
+        if (!fd || fd->semanticRun < PASSsemanticdone || !fd->scope ||
+            !isInlineImport(fd, 1))
+            continue;
+
+        /* Errors in the bodies of imported functions are not ours to
+         * report; such functions are just not inlined.
+         */
+        unsigned errors = global.startGagging();
+        fd->semantic3(fd->scope);
+        if (!global.endGagging(errors) && isInlineImport(fd, 0))
+            fds->push(fd);
+    }
+}
+
+/**************************************
+ * Run semantic3 on the small functions of this imported module that are
+ * not templates, and append them to fds, so that their bodies can be given
+ * to the backend for inlining into the modules being compiled.
+ */
+
+void Module::inlineImports(FuncDeclarations *fds)
+{
+    ::inlineImports(members, fds);
+}
+
 Expression *FuncDeclaration::expandInline(InlineScanState *iss, Expression *ethis, Expressions *arguments, Statement **ps)
 {
     InlineDoState ids;
@@ -39,9 +39,6 @@
 #define LOGASSIGN 0
 #define SHOWPERFORMANCE 0
 
-// Maximum allowable recursive function calls in CTFE
-#define CTFE_RECURSION_LIMIT 1000
-
 /**
   The values of all CTFE variables
 */
@@ -230,8 +227,19 @@ InterState::InterState()
 int CtfeStatus::callDepth = 0;
 int CtfeStatus::stackTraceCallsToSuppress = 0;
 int CtfeStatus::maxCallDepth = 0;
-int CtfeStatus::numArrayAllocs = 0;
-int CtfeStatus::numAssignments = 0;
+ulonglong CtfeStatus::numArrayAllocs = 0;
+ulonglong CtfeStatus::numAssignments = 0;
+ulonglong CtfeStatus::numBytecodeFunctions = 0;
+ulonglong CtfeStatus::numBytecodeCalls = 0;
+ulonglong CtfeStatus::numCalls = 0;
+ulonglong CtfeStatus::numStatements = 0;
+ulonglong CtfeStatus::numMemoHits = 0;
+ulonglong CtfeStatus::numMemoMisses = 0;
+
+size_t CtfeStatus::maxStackUsage()
+{
+    return ctfeStack.maxStackUsage();
+}
 
 // CTFE diagnostic information
 void printCtfePerformanceStats()
@@ -239,7 +247,10 @@ void printCtfePerformanceStats()
 #if SHOWPERFORMANCE
     printf("        ---- CTFE Performance ----\n");
     printf("max call depth = %d\tmax stack = %d\n", CtfeStatus::maxCallDepth, ctfeStack.maxStackUsage());
-    printf("array allocs = %d\tassignments = %d\n\n", CtfeStatus::numArrayAllocs, CtfeStatus::numAssignments);
+    printf("array allocs = %llu\tassignments = %llu\n", CtfeStatus::numArrayAllocs, CtfeStatus::numAssignments);
+    printf("bytecode functions = %llu\tbytecode calls = %llu\n", CtfeStatus::numBytecodeFunctions, CtfeStatus::numBytecodeCalls);
+    printf("calls = %llu\tstatements = %llu\n", CtfeStatus::numCalls, CtfeStatus::numStatements);
+    printf("memo hits = %llu\tmemo misses = %llu\n\n", CtfeStatus::numMemoHits, CtfeStatus::numMemoMisses);
 #endif
 }
 
@@ -286,6 +297,7 @@ Expression *FuncDeclaration::interpret(InterState *istate, Expressions *argument
         return EXP_CANT_INTERPRET;
     if (semanticRun < PASSsemantic3done)
         return EXP_CANT_INTERPRET;
+    ++CtfeStatus::numCalls;
 
     Type *tb = type->toBasetype();
     assert(tb->ty == Tfunction);
@@ -324,6 +336,7 @@ Expression *FuncDeclaration::interpret(InterState *istate, Expressions *argument
             return EXP_CANT_INTERPRET;
     }
     static int evaluatingArgs = 0;
+    Expressions eargs;
     if (arguments)
     {
         dim = arguments->dim;
@@ -333,7 +346,6 @@ Expression *FuncDeclaration::interpret(InterState *istate, Expressions *argument
         /* Evaluate all the arguments to the function,
          * store the results in eargs[]
          */
-        Expressions eargs;
         eargs.setDim(dim);
         for (size_t i = 0; i < dim; i++)
         {   Expression *earg = (*arguments)[i];
@@ -430,6 +442,36 @@ Expression *FuncDeclaration::interpret(InterState *istate, Expressions *argument
         }
     }
 
+    /* Strongly pure functions give the same result for the same
+     * arguments, so their results can be memoized.
+     */
+    Expression *memoresult;
+    CtfeMemoEntry *memo = ctfeMemoFind(this, thisarg, &eargs, &memoresult);
+    if (memoresult)
+    {
+        ctfeStack.endFrame(istatex.framepointer);
+        if (!istate && !evaluatingArgs)
+            memoresult = scrubReturnValue(loc, memoresult);
+        return memoresult;
+    }
+
+    /* Functions which only use integral values and arrays of them
+     * can be run by the much faster bytecode interpreter.
+     */
+    if (!thisarg && !vresult)
+    {
+        Expression *e = ctfeRunBytecode(loc, this, &eargs);
+        if (e)
+        {
+            ctfeStack.endFrame(istatex.framepointer);
+            if (memo && e != EXP_VOID_INTERPRET)
+                ctfeMemoSave(memo, e);
+            if (e != EXP_VOID_INTERPRET && !istate && !evaluatingArgs)
+                e = scrubReturnValue(loc, e);
+            return e;
+        }
+    }
+
     if (vresult)
         ctfeStack.push(vresult);
 
@@ -494,6 +536,9 @@ Expression *FuncDeclaration::interpret(InterState *istate, Expressions *argument
         return EXP_CANT_INTERPRET;
     }
 
+    if (memo && e)
+        ctfeMemoSave(memo, e);
+
     // If we're about to leave CTFE, make sure we don't crash the
     // compiler by returning a CTFE-internal expression.
     if (!istate && !evaluatingArgs)
@@ -510,7 +555,8 @@ Expression *FuncDeclaration::interpret(InterState *istate, Expressions *argument
     {   if (istate->start != this)      \
             return NULL;                \
         istate->start = NULL;           \
-    }
+    }                                   \
+    ++CtfeStatus::numStatements;
 
 /***********************************
  * Interpret the statement.
@@ -757,6 +803,7 @@ Expression *scrubReturnValue(Loc loc, Expression *e)
     if (e->op == TOKstring)
     {
         ((StringExp *)e)->ownedByCtfe = false;
+        freezeCtfeString((StringExp *)e);
     }
     if (e->op == TOKarrayliteral)
     {
@@ -768,6 +815,7 @@ Expression *scrubReturnValue(Loc loc, Expression *e)
     {
         AssocArrayLiteralExp *aae = (AssocArrayLiteralExp *)e;
         aae->ownedByCtfe = false;
+        aae->ctfeIndex = NULL;
         if (!scrubArray(loc, aae->keys))
             return EXP_CANT_INTERPRET;
         if (!scrubArray(loc, aae->values))
@@ -3519,7 +3567,7 @@ Expression *op##AssignExp::interpret(InterState *istate, CtfeGoal goal) \
 
 BIN_ASSIGN_INTERPRET(Add)
 BIN_ASSIGN_INTERPRET(Min)
-BIN_ASSIGN_INTERPRET_CTFE(Cat, ctfeCat)
+BIN_ASSIGN_INTERPRET_CTFE(Cat, ctfeCatAssign)
 BIN_ASSIGN_INTERPRET(Mul)
 BIN_ASSIGN_INTERPRET(Div)
 BIN_ASSIGN_INTERPRET(Mod)
@@ -5064,6 +5112,8 @@ Expression *RemoveExp::interpret(InterState *istate, CtfeGoal goal)
     }
     valuesx->dim = valuesx->dim - removed;
     keysx->dim = keysx->dim - removed;
+    if (removed)
+        aaKeysRemoved();
     return new IntegerExp(loc, removed?1:0, Type::tbool);
 }
 
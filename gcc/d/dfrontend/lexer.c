@@ -257,6 +257,7 @@ Lexer::Lexer(Module *mod,
     this->doDocComment = doDocComment;
     this->anyToken = 0;
     this->commentToken = commentToken;
+    this->tokcache = NULL;
     //initKeywords();
 
     /* If first line starts with '#!', ignore the line
@@ -301,6 +302,8 @@ Lexer::Lexer(Module *mod,
 
 void Lexer::error(const char *format, ...)
 {
+    if (tokcache)
+        tokcache->failed = 1;
     va_list ap;
     va_start(ap, format);
     ::verror(tokenLoc(), format, ap);
@@ -309,6 +312,8 @@ void Lexer::error(const char *format, ...)
 
 void Lexer::error(Loc loc, const char *format, ...)
 {
+    if (tokcache)
+        tokcache->failed = 1;
     va_list ap;
     va_start(ap, format);
     ::verror(loc, format, ap);
@@ -317,6 +322,8 @@ void Lexer::error(Loc loc, const char *format, ...)
 
 void Lexer::deprecation(const char *format, ...)
 {
+    if (tokcache)
+        tokcache->failed = 1;
     va_list ap;
     va_start(ap, format);
     ::vdeprecation(tokenLoc(), format, ap);
@@ -333,6 +340,10 @@ TOK Lexer::nextToken()
         t->next = freelist;
         freelist = t;
     }
+    else if (tokcache)
+    {
+        tokcache->scan(&token);
+    }
     else
     {
         scan(&token);
@@ -349,7 +360,10 @@ Token *Lexer::peek(Token *ct)
     else
     {
         t = new Token();
-        scan(t);
+        if (tokcache)
+            tokcache->scan(t);
+        else
+            scan(t);
         ct->next = t;
     }
     return t;
@@ -2741,6 +2755,12 @@ Loc Lexer::tokenLoc()
     while (last->next)
         last = last->next;
 
+    if (tokcache && !tokcache->record)
+    {   // Replayed tokens have no source, but know their lines
+        result.linnum -= last->linnum - token.linnum;
+        return result;
+    }
+
     unsigned char* start = token.ptr;
     unsigned char* stop = last->ptr;
 
@@ -21,6 +21,8 @@
 struct StringTable;
 struct Identifier;
 struct Module;
+struct File;
+struct Lexer;
 
 /* Tokens:
         (       )
@@ -226,6 +228,7 @@ struct Token
     enum TOK value;
     unsigned char *blockComment; // doc comment string prior to this token
     unsigned char *lineComment;  // doc comment for previous token
+    unsigned linnum;            // line of first character, only set by TokenCache
     union
     {
         // Integers
@@ -263,6 +266,29 @@ struct Token
     static const char *toChars(enum TOK);
 };
 
+/* Tokens of a source file saved by an earlier compile, see tokcache.c
+ */
+
+struct TokenCache
+{
+    static const char *dir;     // where to keep cache files, NULL if none
+
+    Lexer *lexer;
+    File *file;                 // the cache file
+    OutBuffer *record;          // tokens being recorded, NULL if replaying
+    unsigned char *p;           // next token to replay
+    unsigned char *end;
+    const char *filename;       // file name of the source
+    unsigned errors;            // global.errors when recording started
+    int failed;                 // !=0 if the tokens cannot be cached
+
+    TokenCache();
+    int open(Lexer *lexer, unsigned char *buf, size_t buflen);
+    void scan(Token *t);
+    void replay(Token *t);
+    void close();
+};
+
 struct Lexer
 {
     static StringTable stringtable;
@@ -279,6 +305,7 @@ struct Lexer
     int doDocComment;           // collect doc comment information
     int anyToken;               // !=0 means seen at least one token
     int commentToken;           // !=0 means comments are TOKcomment's
+    TokenCache *tokcache;       // if !=NULL, get tokens from it instead of scanning
 
     Lexer(Module *mod,
         unsigned char *base, size_t begoffset, size_t endoffset,
@@ -13,6 +13,7 @@
 #include <ctype.h>
 #include <assert.h>
 
+#include "rmem.h"
 #include "root.h"
 
 #include "init.h"
@@ -23,11 +24,65 @@
 #include "template.h"
 #include "id.h"
 #include "module.h"
+#include "aav.h"
+#include "stringtable.h"
 
 #if CPP_MANGLE
 char *cpp_mangle(Dsymbol *s);
 #endif
 
+char *mangle(Declaration *sthis, bool isv);
+
+/******************************************************************************
+ * Write the mangled names of s and its parents to buf, outermost first.
+ * The names of parents which are not nested in a function are the same
+ * each time, so are kept in prefixtab to be written out again rather than
+ * be built up again for each member.
+ * Returns true if s is one of them.
+ */
+static AA *prefixtab;
+
+static bool manglePrefix(OutBuffer *buf, Dsymbol *s, bool isv)
+{
+    if (!s)
+        return true;
+
+    if (!s->ident)
+    {
+        manglePrefix(buf, s->parent, isv);
+        buf->writestring("0");
+        return false;
+    }
+
+    FuncDeclaration *fd = s->isFuncDeclaration();
+    if (fd)
+    {
+        buf->writestring(mangle(fd, isv));
+        return false;
+    }
+
+    char *p = (char *)_aaGetRvalue(prefixtab, s);
+    if (p)
+    {
+        buf->writestring(p);
+        return true;
+    }
+
+    size_t offset = buf->offset;
+    bool cacheable = manglePrefix(buf, s->parent, isv);
+    char *id = s->ident->toChars();
+    buf->printf("%llu%s", (ulonglong)strlen(id), id);
+    if (cacheable)
+    {
+        size_t len = buf->offset - offset;
+        p = (char *)mem.malloc(len + 1);
+        memcpy(p, buf->data + offset, len);
+        p[len] = 0;
+        *(char **)_aaGet(&prefixtab, s) = p;
+    }
+    return cacheable;
+}
+
 /******************************************************************************
  *  isv     : for the enclosing auto functions of an inner class/struct type.
  *            An aggregate type which defined inside auto function, it might
@@ -39,39 +94,17 @@ char *mangle(Declaration *sthis, bool isv)
 {
     OutBuffer buf;
     char *id;
-    Dsymbol *s;
 
     //printf("::mangle(%s)\n", sthis->toChars());
-    s = sthis;
-    do
+    manglePrefix(&buf, sthis->parent, isv);
+    if (sthis->ident)
     {
-        //printf("mangle: s = %p, '%s', parent = %p\n", s, s->toChars(), s->parent);
-        if (s->ident)
-        {
-            FuncDeclaration *fd = s->isFuncDeclaration();
-            if (s != sthis && fd)
-            {
-                id = mangle(fd, isv);
-                buf.prependstring(id);
-                goto L1;
-            }
-            else
-            {
-                id = s->ident->toChars();
-                size_t len = strlen(id);
-                char tmp[sizeof(len) * 3 + 1];
-                buf.prependstring(id);
-                sprintf(tmp, "%d", (int)len);
-                buf.prependstring(tmp);
-            }
-        }
-        else
-            buf.prependstring("0");
-        s = s->parent;
-    } while (s);
+        id = sthis->ident->toChars();
+        buf.printf("%llu%s", (ulonglong)strlen(id), id);
+    }
+    else
+        buf.writestring("0");
 
-//    buf.prependstring("_D");
-L1:
     //printf("deco = '%s'\n", sthis->type->deco ? sthis->type->deco : "null");
     //printf("sthis->type = %s\n", sthis->type->toChars());
     FuncDeclaration *fd = sthis->isFuncDeclaration();
@@ -105,6 +138,62 @@ L1:
     return id;
 }
 
+/******************************************************************************
+ * Return the name to give the symbol of the D mangled name p in the object
+ * file. If p is longer than -fmangle-limit, that keeps as much of the start
+ * of it as fits and ends it with a hash of the whole name. The same name is
+ * shortened the same way in every compilation, and each one shortened is
+ * written once to the -fmangle-map file as:
+ *      short<TAB>full
+ * Only symbol names are shortened; mangle() and the decos of types built
+ * from it always give the full name.
+ */
+static StringTable *shortmangles;
+
+char *shortMangle(char *p)
+{
+    if (!global.params.mangleLimit || p[0] != '_' || p[1] != 'D')
+        return p;
+    size_t len = strlen(p);
+    if (len <= global.params.mangleLimit)
+        return p;
+
+    if (!shortmangles)
+    {
+        shortmangles = new StringTable();
+        shortmangles->init();
+    }
+    StringValue *sv = shortmangles->update(p, len);
+    if (sv->ptrvalue)
+        return (char *)sv->ptrvalue;
+
+    // FNV-1a
+    ulonglong hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)p[i];
+        hash *= 1099511628211ULL;
+    }
+
+    size_t keep = global.params.mangleLimit - 18;
+    OutBuffer buf;
+    buf.write(p, keep);
+    buf.printf("__%016llx", hash);
+    char *s = buf.toChars();
+    buf.data = NULL;
+    sv->ptrvalue = s;
+
+    if (global.params.mangleMap)
+    {
+        OutBuffer *ob = global.params.mangleMap;
+        ob->writestring(s);
+        ob->writeByte('\t');
+        ob->writestring(p);
+        ob->writenl();
+    }
+    return s;
+}
+
 char *Declaration::mangle(bool isv)
 #if __DMC__
     __out(result)
@@ -249,6 +338,9 @@ char *TemplateInstance::mangle(bool isv)
 {
     OutBuffer buf;
 
+    if (mangled)
+        return mangled;
+
 #if 0
     printf("TemplateInstance::mangle() %p %s", this, toChars());
     if (parent)
@@ -272,6 +364,21 @@ char *TemplateInstance::mangle(bool isv)
     buf.printf("%llu%s", (ulonglong)strlen(id), id);
     id = buf.toChars();
     buf.data = NULL;
+
+    /* Once semantic is done the name no longer changes, unless the
+     * instance is inside a function, whose type may still be inferred.
+     */
+    if (semanticRun >= PASSsemanticdone && !isTemplateMixin() && tempdecl)
+    {
+        Dsymbol *s = isnested ? parent : tempdecl->parent;
+        for (; s; s = s->parent)
+        {
+            if (s->isFuncDeclaration())
+                break;
+        }
+        if (!s)
+            mangled = id;
+    }
     //printf("TemplateInstance::mangle() %s = %s\n", toChars(), id);
     return id;
 }
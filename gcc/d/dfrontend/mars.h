@@ -142,6 +142,8 @@ struct Param
     char quiet;         // suppress non-error messages
     char verbose;       // verbose compile
     char vtls;          // identify thread local variables
+    char vclosures;     // report where closures are allocated
+    char closedHierarchy; // classes are only derived from in the modules compiled
     char symdebug;      // insert debug symbolic information
     bool alwaysframe;   // always emit standard stack frame
     bool optimize;      // run optimizer
@@ -216,6 +218,10 @@ struct Param
     char *moduleDepsFile;       // filename for deps output
     OutBuffer *moduleDeps;      // contents to be written to deps file
 
+    unsigned mangleLimit;       // shorten mangled names longer than this
+    char *mangleMapFile;        // filename for shortened names output
+    OutBuffer *mangleMap;       // contents to be written to mangle map file
+
 #ifdef IN_GCC
     char *makeDepsFile;         // filename for make deps output
     OutBuffer *makeDeps;        // contents to be written to make deps file
@@ -55,6 +55,7 @@ Module::Module(char *filename, Identifier *ident, int doDocComment, int doHdrGen
     members = NULL;
     isDocFile = 0;
     needmoduleinfo = 0;
+    hastemplates = 0;
     selfimports = 0;
     insearch = 0;
     searchCacheIdent = NULL;
@@ -226,9 +227,9 @@ Module *Module::load(Loc loc, Identifiers *packages, Identifier *ident)
     const char *sdi = fdi;
     const char *sd  = fd;
 
-    if (FileName::exists(sdi))
+    if (DirCache::exists(sdi))
         result = sdi;
-    else if (FileName::exists(sd))
+    else if (DirCache::exists(sd))
         result = sd;
     else if (FileName::absolute(filename))
         ;
@@ -240,13 +241,13 @@ Module *Module::load(Loc loc, Identifiers *packages, Identifier *ident)
         {
             const char *p = (*global.path)[i];
             const char *n = FileName::combine(p, sdi);
-            if (FileName::exists(n))
+            if (DirCache::exists(n))
             {   result = n;
                 break;
             }
             FileName::free(n);
             n = FileName::combine(p, sd);
-            if (FileName::exists(n))
+            if (DirCache::exists(n))
             {   result = n;
                 break;
             }
@@ -284,7 +285,11 @@ Module *Module::load(Loc loc, Identifiers *packages, Identifier *ident)
 bool Module::read(Loc loc)
 {
     //printf("Module::read('%s') file '%s'\n", toChars(), srcfile->toChars());
+#if _WIN32
     if (srcfile->read())
+#else
+    if (srcfile->mmread())
+#endif
     {
         if (!strcmp(srcfile->toChars(), "object.d"))
         {
@@ -533,12 +538,15 @@ void Module::parse()
         return;
     }
     Parser p(this, buf, buflen, docfile != NULL);
+    TokenCache tc;
+    if (tc.open(&p, buf, buflen))
+        p.tokcache = &tc;
     p.nextToken();
     members = p.parseModule();
+    if (p.tokcache)
+        tc.close();
 
-    ::free(srcfile->buffer);
-    srcfile->buffer = NULL;
-    srcfile->len = 0;
+    srcfile->freeData();
 
     md = p.md;
     numlines = p.loc.linnum;
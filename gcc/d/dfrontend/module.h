@@ -68,6 +68,8 @@ struct Module : Package
     unsigned numlines;  // number of lines in source file
     int isDocFile;      // if it is a documentation input file, not D source
     int needmoduleinfo;
+    int hastemplates;   // if it declares templates, which other modules
+                        // can instantiate
 
     int selfimports;            // 0: don't know, 1: does not, 2: does
     int selfImports();          // returns !=0 if module imports itself
@@ -125,6 +127,7 @@ struct Module : Package
     void semantic2();   // pass 2 semantic analysis
     void semantic3();   // pass 3 semantic analysis
     void inlineScan();  // scan for functions to inline
+    void inlineImports(FuncDeclarations *fds); // functions for other modules to inline
     void genhdrfile();  // generate D import file
     void genobjfile(int multiobj);
     void gensymfile();
@@ -1653,6 +1653,107 @@ char *Type::modToChars()
 /************************************
  */
 
+/* Table of merged types built on other merged types, keyed on the pointer
+ * to the type they are built on, their modifiers and, for static arrays
+ * and associative arrays, the dimension or key type. Their deco is fully
+ * determined by these, so merge() can find a type seen before without
+ * building its deco and looking that up in stringtable.
+ */
+
+struct MergeEntry
+{
+    Type *next;
+    uinteger_t extra;
+    unsigned char ty;
+    unsigned char mod;
+    Type *t;                    // the merged type
+};
+
+static MergeEntry *mergetab;
+static size_t mergetabdim;      // always a power of 2
+static size_t mergecount;
+
+/********************************
+ * Get the key for t in mergetab.
+ * Returns:
+ *      0 if t is not kept in mergetab
+ */
+
+static int mergeKey(Type *t, Type **pnext, uinteger_t *pextra)
+{
+    switch (t->ty)
+    {
+        case Tpointer:
+        case Tarray:
+        case Treference:
+        case Tdelegate:
+            *pnext = t->nextOf();
+            *pextra = 0;
+            return 1;
+
+        case Tsarray:
+        {   Expression *dim = ((TypeSArray *)t)->dim;
+            if (!dim || dim->op != TOKint64)
+                return 0;
+            *pnext = t->nextOf();
+            *pextra = dim->toInteger();
+            return 1;
+        }
+
+        case Taarray:
+        {   Type *index = ((TypeAArray *)t)->index;
+            if (!index->deco)
+                return 0;
+            *pnext = t->nextOf();
+            *pextra = (uinteger_t)(size_t)index;
+            return 1;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+static MergeEntry *mergeLookup(Type *next, uinteger_t extra, unsigned ty, unsigned mod)
+{
+    size_t h = ((size_t)next >> 3) ^ (size_t)(extra * 0x9E3779B97F4A7C15ULL) ^ (ty << 8) ^ mod;
+    h ^= h >> 15;
+    size_t mask = mergetabdim - 1;
+    for (size_t i = h & mask; 1; i = (i + 1) & mask)
+    {   MergeEntry *me = &mergetab[i];
+        if (!me->t ||
+            (me->next == next && me->extra == extra && me->ty == ty && me->mod == mod))
+            return me;
+    }
+}
+
+static void mergeInsert(Type *next, uinteger_t extra, Type *t)
+{
+    if (2 * (mergecount + 1) > mergetabdim)
+    {
+        MergeEntry *oldtab = mergetab;
+        size_t olddim = mergetabdim;
+
+        mergetabdim = olddim ? olddim * 2 : 1024;
+        mergetab = (MergeEntry *)mem.calloc(mergetabdim, sizeof(MergeEntry));
+        for (size_t i = 0; i < olddim; i++)
+        {   MergeEntry *me = &oldtab[i];
+            if (me->t)
+                *mergeLookup(me->next, me->extra, me->ty, me->mod) = *me;
+        }
+        mem.free(oldtab);
+    }
+    MergeEntry *me = mergeLookup(next, extra, t->ty, t->mod);
+    if (!me->t)
+    {   me->next = next;
+        me->extra = extra;
+        me->ty = t->ty;
+        me->mod = t->mod;
+        me->t = t;
+        mergecount++;
+    }
+}
+
 Type *Type::merge()
 {
     if (ty == Terror) return this;
@@ -1671,6 +1772,16 @@ Type *Type::merge()
     {
         OutBuffer buf;
         StringValue *sv;
+        Type *tnext;
+        uinteger_t extra;
+        int iskeyed = mergeKey(this, &tnext, &extra);
+
+        if (iskeyed && mergetab)
+        {
+            MergeEntry *me = mergeLookup(tnext, extra, ty, mod);
+            if (me->t)
+                return me->t;
+        }
 
         //if (next)
             //next = next->merge();
@@ -1691,6 +1802,8 @@ Type *Type::merge()
             deco = (char *)sv->toDchars();
             //printf("new value, deco = '%s' %p\n", t->deco, t->deco);
         }
+        if (iskeyed)
+            mergeInsert(tnext, extra, t);
     }
     return t;
 }
@@ -11,6 +11,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifndef MEM_ARENA
+#define MEM_ARENA 0     // allocate with operator new from pools, see below
+#endif
+
 #ifdef IN_GCC
 #include "rmem.h"
 #else
@@ -38,7 +42,9 @@ char *Mem::strdup(const char *s)
     {
         p = ::strdup(s);
         if (p)
+        {   allocated += strlen(p) + 1;
             return p;
+        }
         error();
     }
     return NULL;
@@ -54,6 +60,7 @@ void *Mem::malloc(size_t size)
         p = ::malloc(size);
         if (!p)
             error();
+        allocated += size;
     }
     return p;
 }
@@ -68,6 +75,7 @@ void *Mem::calloc(size_t size, size_t n)
         p = ::calloc(size, n);
         if (!p)
             error();
+        allocated += size * n;
     }
     return p;
 }
@@ -85,6 +93,7 @@ void *Mem::realloc(void *p, size_t size)
         p = ::malloc(size);
         if (!p)
             error();
+        allocated += size;
     }
     else
     {
@@ -94,6 +103,7 @@ void *Mem::realloc(void *p, size_t size)
         {   free(psave);
             error();
         }
+        allocated += size;
     }
     return p;
 }
@@ -116,6 +126,7 @@ void *Mem::mallocdup(void *o, size_t size)
             error();
         else
             memcpy(p,o,size);
+        allocated += size;
     }
     return p;
 }
@@ -146,8 +157,170 @@ void Mem::addroots(char* pStart, char* pEnd)
 
 /* =================================================== */
 
+#if MEM_ARENA
+
+/* Region allocator used by operator new.
+ * The frontend allocates a great many small objects and hardly ever frees
+ * them, so instead of going through malloc each one is bumped off a chunk
+ * that holds objects of a single size class. Deleted objects go on a free
+ * list for their class. Anything larger than ARENA_MAXSIZE uses malloc.
+ * Not thread safe, only the main thread may allocate.
+ */
+
+#define ARENA_ALIGN     16
+#define ARENA_MAXSIZE   256
+#define ARENA_NCLASSES  (ARENA_MAXSIZE / ARENA_ALIGN)
+#define ARENA_CHUNKSIZE (256 * 1024)
+
+struct ArenaChunk
+{
+    char *base;
+    size_t sizeclass;
+};
+
+struct ArenaPool
+{
+    char *ptr;                  // next free byte in the current chunk
+    char *end;                  // end of the current chunk
+    void *freelist;             // deleted objects of this size
+    size_t nallocs;             // allocations since the last stats()
+    size_t nchunks;
+};
+
+static ArenaPool arenapools[ARENA_NCLASSES];
+
+// All chunks, sorted by address, so operator delete can tell which
+// pointers it owns
+static ArenaChunk *arenachunks;
+static size_t arenanchunks;
+static size_t arenamaxchunks;
+
+static size_t arenanlarge;      // malloc'd objects since the last stats()
+static size_t arenalargesize;
+
+static size_t arenaFind(void *p)
+{
+    size_t lo = 0;
+    size_t hi = arenanchunks;
+
+    // Find the last chunk starting at or below p
+    while (lo < hi)
+    {   size_t mid = (lo + hi) / 2;
+        if (arenachunks[mid].base <= (char *)p)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo && (char *)p < arenachunks[lo - 1].base + ARENA_CHUNKSIZE)
+        return lo - 1;
+    return ~(size_t)0;
+}
+
+static void arenaNewChunk(size_t sizeclass)
+{
+    char *base = (char *)::malloc(ARENA_CHUNKSIZE);
+    if (!base)
+        mem.error();
+
+    if (arenanchunks == arenamaxchunks)
+    {
+        arenamaxchunks = arenamaxchunks ? arenamaxchunks * 2 : 64;
+        arenachunks = (ArenaChunk *)::realloc(arenachunks, arenamaxchunks * sizeof(ArenaChunk));
+        if (!arenachunks)
+            mem.error();
+    }
+    size_t i = arenanchunks;
+    while (i && arenachunks[i - 1].base > base)
+    {   arenachunks[i] = arenachunks[i - 1];
+        i--;
+    }
+    arenachunks[i].base = base;
+    arenachunks[i].sizeclass = sizeclass;
+    arenanchunks++;
+
+    // malloc only guarantees 8 byte alignment on some hosts
+    ArenaPool *pool = &arenapools[sizeclass];
+    pool->ptr = (char *)(((size_t)base + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1));
+    pool->end = base + ARENA_CHUNKSIZE;
+    pool->nchunks++;
+}
+
+void * operator new(size_t m_size)
+{
+    mem.allocated += m_size;
+    if (m_size > ARENA_MAXSIZE)
+    {
+        void *p = ::malloc(m_size);
+        if (!p)
+            mem.error();
+        arenanlarge++;
+        arenalargesize += m_size;
+        return p;
+    }
+
+    size_t sizeclass = m_size ? (m_size - 1) / ARENA_ALIGN : 0;
+    size_t size = (sizeclass + 1) * ARENA_ALIGN;
+    ArenaPool *pool = &arenapools[sizeclass];
+    void *p;
+
+    pool->nallocs++;
+    if (pool->freelist)
+    {
+        p = pool->freelist;
+        pool->freelist = *(void **)p;
+        return p;
+    }
+    if (pool->ptr + size > pool->end)
+        arenaNewChunk(sizeclass);
+    p = pool->ptr;
+    pool->ptr += size;
+    return p;
+}
+
+void operator delete(void *p)
+{
+    if (!p)
+        return;
+    size_t i = arenaFind(p);
+    if (i == ~(size_t)0)
+    {   ::free(p);
+        return;
+    }
+    ArenaPool *pool = &arenapools[arenachunks[i].sizeclass];
+    *(void **)p = pool->freelist;
+    pool->freelist = p;
+}
+
+void Mem::stats(const char *phase)
+{
+    size_t nallocs = 0;
+    size_t size = 0;
+
+    for (size_t i = 0; i < ARENA_NCLASSES; i++)
+    {   ArenaPool *pool = &arenapools[i];
+        nallocs += pool->nallocs;
+        size += pool->nallocs * (i + 1) * ARENA_ALIGN;
+    }
+    fprintf(stderr, "memory    %-10s %8llu objects %10llu bytes pooled, %6llu objects %10llu bytes malloc'd, %llu chunks\n",
+        phase, (unsigned long long)nallocs, (unsigned long long)size,
+        (unsigned long long)arenanlarge, (unsigned long long)arenalargesize,
+        (unsigned long long)arenanchunks);
+    for (size_t i = 0; i < ARENA_NCLASSES; i++)
+    {   ArenaPool *pool = &arenapools[i];
+        if (pool->nallocs)
+            fprintf(stderr, "          %4d bytes %8llu\n", (int)((i + 1) * ARENA_ALIGN),
+                (unsigned long long)pool->nallocs);
+        pool->nallocs = 0;
+    }
+    arenanlarge = 0;
+    arenalargesize = 0;
+}
+
+#else
+
 void * operator new(size_t m_size)
 {
+    mem.allocated += m_size;
     void *p = malloc(m_size);
     if (p)
         return p;
@@ -161,4 +334,10 @@ void operator delete(void *p)
     free(p);
 }
 
+void Mem::stats(const char *phase)
+{
+}
+
+#endif
+
 
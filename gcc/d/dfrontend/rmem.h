@@ -19,7 +19,8 @@ struct GC;                      // thread specific allocator
 struct Mem
 {
     GC *gc;                     // pointer to our thread specific allocator
-    Mem() { gc = NULL; }
+    unsigned long long allocated; // bytes allocated so far
+    Mem() { gc = NULL; allocated = 0; }
 
     void init();
 
@@ -50,6 +51,7 @@ struct Mem
     void setFinalizer(void* pObj, FINALIZERPROC pFn, void* pClientData);
     void setStackBottom(void *bottom);
     GC *getThreadGC();          // get apartment allocator for this thread
+    void stats(const char *phase); // print allocations since last call
 };
 
 extern Mem mem;
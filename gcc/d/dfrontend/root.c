@@ -45,11 +45,15 @@
 #include <errno.h>
 #include <unistd.h>
 #include <utime.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <time.h>
 #endif
 
 //#include "port.h"
 #include "root.h"
 #include "rmem.h"
+#include "stringtable.h"
 
 #if 0 //__SC__ //def DEBUG
 extern "C" void __cdecl _assert(void *e, void *f, unsigned line)
@@ -941,6 +945,353 @@ void FileName::free(const char *str)
 }
 
 
+/****************************** DirCache ********************************/
+
+/* Looking for a file along a path costs a stat() per directory and
+ * extension, for every import. Instead, read each directory once and
+ * look names up in its listing. The listings can be saved to a file and
+ * reused by later compiles for as long as the directory's mtime matches.
+ *
+ * Symbolic links are the exception: their targets may come and go without
+ * the directory changing, so they are listed but still stat()ed on lookup.
+ */
+
+#define DIRCACHE_HEADER "gdc-dircache 2\n"
+
+struct DirListing
+{
+    DirListing *next;           // all listings, for save()
+    const char *dir;
+    long long mtime;
+    int exists;                 // != 0 if dir is a readable directory
+    int stable;                 // != 0 if mtime shows any later change
+    StringTable names;
+    OutBuffer list;             // the names, one per line, for save()
+
+    DirListing(const char *dir)
+    {
+        this->next = NULL;
+        this->dir = dir;
+        this->mtime = 0;
+        this->exists = 0;
+        this->stable = 0;
+        names.init(61);
+    }
+
+    // A link is marked by a leading / in list, which no name can have
+    void add(const char *name, size_t len, int islink)
+    {
+        StringValue *sv = names.insert(name, len);
+        if (sv)
+        {   sv->ptrvalue = islink ? this : NULL;
+            if (islink)
+                list.writeByte('/');
+            list.write(name, len);
+            list.writeByte('\n');
+        }
+    }
+};
+
+static StringTable *dircache;
+static DirListing *dirlistings;
+static int dircachedirty;       // != 0 if a directory was read
+
+static DirListing *dirListing(const char *dir, size_t dirlen)
+{
+    if (!dircache)
+    {   dircache = new StringTable();
+        dircache->init(61);
+    }
+    StringValue *sv = dircache->update(dir, dirlen);
+    DirListing *dl = (DirListing *)sv->ptrvalue;
+    if (dl)
+        return dl;
+
+    dl = new DirListing(sv->toDchars());
+    dl->next = dirlistings;
+    dirlistings = dl;
+    sv->ptrvalue = dl;
+#if POSIX
+    struct stat st;
+    DIR *d;
+
+    if (stat(dl->dir, &st) == 0 && S_ISDIR(st.st_mode) &&
+        (d = opendir(dl->dir)) != NULL)
+    {
+        struct dirent *de;
+        OutBuffer path;
+
+        dl->exists = 1;
+        dl->mtime = st.st_mtime;
+        /* mtime only counts seconds, so a name added later in the same
+         * second it was read would not change it. Don't save such a listing.
+         */
+        dl->stable = st.st_mtime < time(NULL);
+        while ((de = readdir(d)) != NULL)
+        {
+            int islink = 0;
+#ifdef _DIRENT_HAVE_D_TYPE
+            if (de->d_type == DT_LNK || de->d_type == DT_UNKNOWN)
+#endif
+            {   // Leave out dangling links, as FileName::exists() would
+                struct stat lst;
+
+                path.reset();
+                path.printf("%s/%s", dl->dir, de->d_name);
+                path.writeByte(0);
+                if (lstat((char *)path.data, &lst) != 0)
+                    continue;
+                if (S_ISLNK(lst.st_mode))
+                {   if (stat((char *)path.data, &lst) != 0)
+                        continue;
+                    islink = 1;
+                }
+            }
+            dl->add(de->d_name, strlen(de->d_name), islink);
+        }
+        closedir(d);
+        dircachedirty = 1;
+    }
+#endif
+    return dl;
+}
+
+/*************************************
+ * Same as FileName::exists(name) != 0, but answered from the listing
+ * of the directory name is in.
+ */
+
+int DirCache::exists(const char *name)
+{
+#if POSIX
+    const char *base = strrchr(name, '/');
+    DirListing *dl;
+
+    if (!base)
+    {   dl = dirListing(".", 1);
+        base = name;
+    }
+    else
+    {   // Keep the / of a file in the root directory
+        dl = dirListing(name, base == name ? 1 : base - name);
+        base++;
+    }
+    StringValue *sv = dl->names.lookup(base, strlen(base));
+    if (sv && sv->ptrvalue)
+        return FileName::exists(name) != 0;     // a link
+    return sv != NULL;
+#else
+    return FileName::exists(name) != 0;
+#endif
+}
+
+/*************************************
+ * Read listings saved by save(). Those of directories that have been
+ * modified since are dropped. A missing or bad file is not an error.
+ */
+
+void DirCache::load(const char *filename)
+{
+#if POSIX
+    File f(filename);
+
+    if (f.read())
+        return;
+    char *p = (char *)f.buffer;
+    char *end = p + f.len;
+    size_t hlen = sizeof(DIRCACHE_HEADER) - 1;
+    if (f.len < hlen || memcmp(p, DIRCACHE_HEADER, hlen) != 0)
+        return;                 // another version
+    p += hlen;
+    while (p < end)
+    {
+        // Each directory is a line "mtime dir", then its names, then an empty line
+        char *eol = (char *)memchr(p, '\n', end - p);
+        if (!eol)
+            break;
+        *eol = 0;
+        char *dir;
+        long long mtime = strtoll(p, &dir, 10);
+        if (*dir != ' ')
+            break;
+        dir++;
+        p = eol + 1;
+
+        struct stat st;
+        DirListing *dl = NULL;
+        if (stat(dir, &st) == 0 && S_ISDIR(st.st_mode) && st.st_mtime == mtime)
+        {
+            if (!dircache)
+            {   dircache = new StringTable();
+                dircache->init(61);
+            }
+            StringValue *sv = dircache->insert(dir, strlen(dir));
+            if (sv)
+            {   dl = new DirListing(sv->toDchars());
+                dl->next = dirlistings;
+                dirlistings = dl;
+                dl->exists = 1;
+                dl->stable = 1;
+                dl->mtime = mtime;
+                sv->ptrvalue = dl;
+            }
+        }
+        while (p < end && *p != '\n')
+        {
+            eol = (char *)memchr(p, '\n', end - p);
+            if (!eol)
+                eol = end;
+            if (dl)
+            {   if (*p == '/')
+                    dl->add(p + 1, eol - p - 1, 1);
+                else
+                    dl->add(p, eol - p, 0);
+            }
+            p = eol + 1;
+        }
+        p++;
+    }
+#endif
+}
+
+/*************************************
+ * Write the listings to filename, if any directory had to be read.
+ */
+
+void DirCache::save(const char *filename)
+{
+#if POSIX
+    if (!dircachedirty)
+        return;
+
+    OutBuffer buf;
+    buf.writestring(DIRCACHE_HEADER);
+    for (DirListing *dl = dirlistings; dl; dl = dl->next)
+    {
+        if (!dl->exists || !dl->stable)
+            continue;
+        buf.printf("%lld %s\n", dl->mtime, dl->dir);
+        buf.write(dl->list.data, dl->list.offset);
+        buf.writeByte('\n');
+    }
+
+    // Replace the file in one go, other compiles may be reading it
+    OutBuffer tmpname;
+    tmpname.printf("%s.%d", filename, (int)getpid());
+    tmpname.writeByte(0);
+    File f((char *)tmpname.data);
+    f.setbuffer(buf.data, buf.offset);
+    f.ref = 1;
+    if (f.write() == 0 && rename((char *)tmpname.data, filename) == 0)
+        dircachedirty = 0;
+    else
+        ::remove((char *)tmpname.data);
+#endif
+}
+
+#if UNITTEST && POSIX
+
+static void dircacheTouch(const char *dir, const char *name)
+{
+    OutBuffer buf;
+    buf.printf("%s/%s", dir, name);
+    buf.writeByte(0);
+    FILE *fp = fopen((char *)buf.data, "w");
+    assert(fp);
+    fclose(fp);
+}
+
+static int dircacheExists(const char *dir, const char *name)
+{
+    OutBuffer buf;
+    buf.printf("%s/%s", dir, name);
+    buf.writeByte(0);
+    int result = DirCache::exists((char *)buf.data);
+    assert(result == (FileName::exists((char *)buf.data) != 0));
+    return result;
+}
+
+// Forget the listings read so far, as a new compile would
+static void dircacheForget()
+{
+    dircache = NULL;
+    dirlistings = NULL;
+    dircachedirty = 0;
+}
+
+void unittest_dircache()
+{
+    char dir[] = "/tmp/dircacheXXXXXX";
+    assert(mkdtemp(dir));
+
+    OutBuffer sub, cache, target;
+    sub.printf("%s/sub", dir);
+    sub.writeByte(0);
+    cache.printf("%s.cache", dir);
+    cache.writeByte(0);
+    target.printf("%s/sub/t.d", dir);
+    target.writeByte(0);
+
+    assert(mkdir((char *)sub.data, 0700) == 0);
+    dircacheTouch(dir, "a.d");
+    dircacheTouch((char *)sub.data, "t.d");
+    OutBuffer link, dangling;
+    link.printf("%s/link.d", dir);
+    link.writeByte(0);
+    dangling.printf("%s/dangling.d", dir);
+    dangling.writeByte(0);
+    assert(symlink("sub/t.d", (char *)link.data) == 0);
+    assert(symlink("nowhere.d", (char *)dangling.data) == 0);
+
+    // Only listings of directories last changed before now are saved
+    struct utimbuf past;
+    past.actime = past.modtime = time(NULL) - 10;
+    assert(utime(dir, &past) == 0);
+
+    dircacheForget();
+    assert(dircacheExists(dir, "a.d"));
+    assert(dircacheExists(dir, "sub"));
+    assert(dircacheExists(dir, "link.d"));
+    assert(!dircacheExists(dir, "dangling.d"));
+    assert(!dircacheExists(dir, "b.d"));
+    DirCache::save((char *)cache.data);
+
+    // Answered from the loaded listing, except for the link, whose
+    // target has gone since.
+    dircacheForget();
+    DirCache::load((char *)cache.data);
+    assert(unlink((char *)target.data) == 0);
+    assert(dircacheExists(dir, "a.d"));
+    assert(!dircacheExists(dir, "link.d"));
+    assert(!dircacheExists(dir, "dangling.d"));
+    assert(!dircacheExists(dir, "b.d"));
+    assert(!dircachedirty);
+
+    // A listing of a directory changed since it was saved is dropped
+    dircacheTouch(dir, "b.d");
+    dircacheForget();
+    DirCache::load((char *)cache.data);
+    assert(dircacheExists(dir, "b.d"));
+    assert(dircachedirty);
+
+    dircacheForget();
+    unlink((char *)cache.data);
+    unlink((char *)link.data);
+    unlink((char *)dangling.data);
+    OutBuffer name;
+    const char *names[] = { "a.d", "b.d" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {   name.reset();
+        name.printf("%s/%s", dir, names[i]);
+        name.writeByte(0);
+        unlink((char *)name.data);
+    }
+    rmdir((char *)sub.data);
+    rmdir(dir);
+}
+
+#endif
+
 /****************************** File ********************************/
 
 File::File(const FileName *n)
@@ -970,12 +1321,38 @@ File::~File()
 #if _WIN32
         else if (ref == 2)
             UnmapViewOfFile(buffer);
+#elif POSIX
+        else if (ref == 2)
+            munmap(buffer, len);
 #endif
     }
     if (touchtime)
         mem.free(touchtime);
 }
 
+/*************************************
+ * Release the contents of the file, read or mapped.
+ */
+
+void File::freeData()
+{
+    if (buffer)
+    {
+        if (ref == 0)
+            ::free(buffer);
+#if _WIN32
+        else if (ref == 2)
+            UnmapViewOfFile(buffer);
+#elif POSIX
+        else if (ref == 2)
+            munmap(buffer, len);
+#endif
+    }
+    ref = 0;
+    buffer = NULL;
+    len = 0;
+}
+
 void File::mark()
 {
     mem.mark(buffer);
@@ -1007,7 +1384,10 @@ int File::read()
 
     if (!ref)
         ::free(buffer);
+    else if (ref == 2)
+        munmap(buffer, len);
     ref = 0;       // we own the buffer now
+    buffer = NULL;
 
     //printf("\tfile opened\n");
     if (fstat(fd, &buf))
@@ -1122,6 +1502,50 @@ err1:
 int File::mmread()
 {
 #if POSIX
+    /* Like read(), the buffer must be followed by two 0 bytes as a sentinel
+     * for the scanner. Those come for free from the zero filled tail of the
+     * last page, so only map the file if there is a tail and it is long
+     * enough.
+     */
+    int fd;
+    struct stat buf;
+    size_t pagesize;
+    size_t size;
+    void *p;
+    char *name;
+
+    name = this->name->toChars();
+    //printf("File::mmread('%s')\n",name);
+    fd = open(name, O_RDONLY);
+    if (fd == -1)
+        return 1;
+    if (fstat(fd, &buf) || !S_ISREG(buf.st_mode))
+        goto Lread;
+    size = buf.st_size;
+    pagesize = sysconf(_SC_PAGESIZE);
+    if (size % pagesize == 0 || size % pagesize > pagesize - 2)
+        goto Lread;
+
+    // Private, so that writes to the buffer do not reach the file
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED)
+        goto Lread;
+    close(fd);
+
+    if (!ref)
+        ::free(buffer);
+    else if (ref == 2)
+        munmap(buffer, len);
+    buffer = NULL;
+    ref = 2;
+    buffer = (unsigned char *)p;
+    len = size;
+    if (touchtime)
+        memcpy(touchtime, &buf, sizeof(buf));
+    return 0;
+
+Lread:
+    close(fd);
     return read();
 #elif _WIN32
     HANDLE hFile;
@@ -1164,7 +1588,7 @@ int File::mmread()
 Lerr:
     return GetLastError();                      // failure
 #else
-    assert(0);
+    return read();
 #endif
 }
 
@@ -134,6 +134,13 @@ struct FileName : String
     static void free(const char *str);
 };
 
+struct DirCache
+{
+    static int exists(const char *name);
+    static void load(const char *filename);
+    static void save(const char *filename);
+};
+
 struct File : Object
 {
     int ref;                    // != 0 if this is a reference to someone else's buffer
@@ -173,6 +180,11 @@ struct File : Object
 
     void mmreadv();
 
+    /* Free the buffer, whether read or mapped.
+     */
+
+    void freeData();
+
     /* Write file, return !=0 if error
      */
 
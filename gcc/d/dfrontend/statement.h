@@ -50,6 +50,8 @@ struct DefaultStatement;
 struct LabelStatement;
 struct HdrGenState;
 struct InterState;
+struct CtfeCompiler;
+struct EscapeState;
 
 enum TOK;
 
@@ -108,6 +110,8 @@ struct Statement : Object
     virtual Statement *scopeCode(Scope *sc, Statement **sentry, Statement **sexit, Statement **sfinally);
     virtual Statements *flatten(Scope *sc);
     virtual Expression *interpret(InterState *istate);
+    virtual int ctfeCompile(CtfeCompiler *cc);
+    virtual int escapeScan(EscapeState *es);
     virtual Statement *last();
 
     virtual int inlineCost(InlineCostState *ics);
@@ -146,6 +150,8 @@ struct ExpStatement : Statement
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     Statement *semantic(Scope *sc);
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
+    int escapeScan(EscapeState *es);
     int blockExit(bool mustNotThrow);
     int isEmpty();
     Statement *scopeCode(Scope *sc, Statement **sentry, Statement **sexit, Statement **sfinally);
@@ -201,6 +207,8 @@ struct CompoundStatement : Statement
     Statements *flatten(Scope *sc);
     ReturnStatement *isReturnStatement();
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
+    int escapeScan(EscapeState *es);
     Statement *last();
 
     int inlineCost(InlineCostState *ics);
@@ -236,6 +244,7 @@ struct UnrolledLoopStatement : Statement
     int blockExit(bool mustNotThrow);
     int comeFrom();
     Expression *interpret(InterState *istate);
+    int escapeScan(EscapeState *es);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
     int inlineCost(InlineCostState *ics);
@@ -262,6 +271,8 @@ struct ScopeStatement : Statement
     int comeFrom();
     int isEmpty();
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
+    int escapeScan(EscapeState *es);
 
     int inlineCost(InlineCostState *ics);
     Expression *doInline(InlineDoState *ids);
@@ -306,6 +317,8 @@ struct DoStatement : Statement
     int blockExit(bool mustNotThrow);
     int comeFrom();
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
+    int escapeScan(EscapeState *es);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
     Statement *inlineScan(InlineScanState *iss);
@@ -338,6 +351,8 @@ struct ForStatement : Statement
     int blockExit(bool mustNotThrow);
     int comeFrom();
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
+    int escapeScan(EscapeState *es);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
     int inlineCost(InlineCostState *ics);
@@ -423,6 +438,8 @@ struct IfStatement : Statement
     Statement *syntaxCopy();
     Statement *semantic(Scope *sc);
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
+    int escapeScan(EscapeState *es);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     bool usesEH();
     int blockExit(bool mustNotThrow);
@@ -501,6 +518,8 @@ struct SwitchStatement : Statement
     bool usesEH();
     int blockExit(bool mustNotThrow);
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
+    int escapeScan(EscapeState *es);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
     Statement *inlineScan(InlineScanState *iss);
@@ -524,6 +543,8 @@ struct CaseStatement : Statement
     int blockExit(bool mustNotThrow);
     int comeFrom();
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
+    int escapeScan(EscapeState *es);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     CaseStatement *isCaseStatement() { return this; }
 
@@ -562,6 +583,8 @@ struct DefaultStatement : Statement
     int blockExit(bool mustNotThrow);
     int comeFrom();
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
+    int escapeScan(EscapeState *es);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     DefaultStatement *isDefaultStatement() { return this; }
 
@@ -578,6 +601,7 @@ struct GotoDefaultStatement : Statement
     Statement *syntaxCopy();
     Statement *semantic(Scope *sc);
     Expression *interpret(InterState *istate);
+    int escapeScan(EscapeState *es);
     int blockExit(bool mustNotThrow);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
@@ -593,6 +617,7 @@ struct GotoCaseStatement : Statement
     Statement *syntaxCopy();
     Statement *semantic(Scope *sc);
     Expression *interpret(InterState *istate);
+    int escapeScan(EscapeState *es);
     int blockExit(bool mustNotThrow);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
@@ -605,6 +630,7 @@ struct SwitchErrorStatement : Statement
     int blockExit(bool mustNotThrow);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
+    int escapeScan(EscapeState *es);
     void toIR(IRState *irs);
 };
 
@@ -619,6 +645,8 @@ struct ReturnStatement : Statement
     Statement *semantic(Scope *sc);
     int blockExit(bool mustNotThrow);
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
+    int escapeScan(EscapeState *es);
 
     int inlineCost(InlineCostState *ics);
     Expression *doInline(InlineDoState *ids);
@@ -638,6 +666,8 @@ struct BreakStatement : Statement
     Statement *syntaxCopy();
     Statement *semantic(Scope *sc);
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
+    int escapeScan(EscapeState *es);
     int blockExit(bool mustNotThrow);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
@@ -652,6 +682,8 @@ struct ContinueStatement : Statement
     Statement *syntaxCopy();
     Statement *semantic(Scope *sc);
     Expression *interpret(InterState *istate);
+    int ctfeCompile(CtfeCompiler *cc);
+    int escapeScan(EscapeState *es);
     int blockExit(bool mustNotThrow);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
@@ -677,6 +709,7 @@ struct SynchronizedStatement : Statement
 // Back end
     elem *esync;
     SynchronizedStatement(Loc loc, elem *esync, Statement *body);
+    int escapeScan(EscapeState *es);
     void toIR(IRState *irs);
 };
 
@@ -693,6 +726,7 @@ struct WithStatement : Statement
     bool usesEH();
     int blockExit(bool mustNotThrow);
     Expression *interpret(InterState *istate);
+    int escapeScan(EscapeState *es);
 
     Statement *inlineScan(InlineScanState *iss);
 
@@ -711,6 +745,7 @@ struct TryCatchStatement : Statement
     bool usesEH();
     int blockExit(bool mustNotThrow);
     Expression *interpret(InterState *istate);
+    int escapeScan(EscapeState *es);
 
     Statement *inlineScan(InlineScanState *iss);
 
@@ -749,6 +784,7 @@ struct TryFinallyStatement : Statement
     bool usesEH();
     int blockExit(bool mustNotThrow);
     Expression *interpret(InterState *istate);
+    int escapeScan(EscapeState *es);
 
     Statement *inlineScan(InlineScanState *iss);
 
@@ -784,6 +820,7 @@ struct ThrowStatement : Statement
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
     int blockExit(bool mustNotThrow);
     Expression *interpret(InterState *istate);
+    int escapeScan(EscapeState *es);
 
     Statement *inlineScan(InlineScanState *iss);
 
@@ -828,6 +865,7 @@ struct GotoStatement : Statement
     Statement *semantic(Scope *sc);
     int blockExit(bool mustNotThrow);
     Expression *interpret(InterState *istate);
+    int escapeScan(EscapeState *es);
 
     void toIR(IRState *irs);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
@@ -850,6 +888,7 @@ struct LabelStatement : Statement
     int blockExit(bool mustNotThrow);
     int comeFrom();
     Expression *interpret(InterState *istate);
+    int escapeScan(EscapeState *es);
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
     Statement *inlineScan(InlineScanState *iss);
@@ -901,6 +940,7 @@ struct ImportStatement : Statement
     int blockExit(bool mustNotThrow);
     int isEmpty();
     Expression *interpret(InterState *istate);
+    int escapeScan(EscapeState *es);
 
     void toCBuffer(OutBuffer *buf, HdrGenState *hgs);
 
@@ -18,41 +18,37 @@
 #include "stringtable.h"
 
 // TODO: Merge with root.String
+// MurmurHash64A, by Austin Appleby, which is in the public domain.
 hash_t calcHash(const char *str, size_t len)
 {
-    hash_t hash = 0;
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    const uint8_t *p = (const uint8_t *)str;
+    uint64_t hash = 0x8445d61a4e774912ULL ^ (len * m);
 
-    while (1)
+    for (; len >= 8; p += 8, len -= 8)
     {
-        switch (len)
-        {
-            case 0:
-                return hash;
-
-            case 1:
-                hash *= 37;
-                hash += *(const uint8_t *)str;
-                return hash;
-
-            case 2:
-                hash *= 37;
-                hash += *(const uint16_t *)str;
-                return hash;
-
-            case 3:
-                hash *= 37;
-                hash += (*(const uint16_t *)str << 8) +
-                        ((const uint8_t *)str)[2];
-                return hash;
-
-            default:
-                hash *= 37;
-                hash += *(const uint32_t *)str;
-                str += 4;
-                len -= 4;
-                break;
-        }
+        uint64_t k;
+        memcpy(&k, p, 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        hash ^= k;
+        hash *= m;
     }
+
+    if (len)
+    {
+        uint64_t k = 0;
+        memcpy(&k, p, len);
+        hash ^= k;
+        hash *= m;
+    }
+
+    hash ^= hash >> r;
+    hash *= m;
+    hash ^= hash >> r;
+    return (hash_t)hash;
 }
 
 void StringValue::ctor(const char *p, size_t length)
@@ -62,10 +58,34 @@ void StringValue::ctor(const char *p, size_t length)
     memcpy(this->lstring, p, length * sizeof(char));
 }
 
+struct StringEntry
+{
+    StringValue value;
+
+    static StringEntry *alloc(const char *s, size_t len);
+};
+
+StringEntry *StringEntry::alloc(const char *s, size_t len)
+{
+    StringEntry *se;
+
+    se = (StringEntry *) mem.calloc(1,sizeof(StringEntry) + len + 1);
+    se->value.ctor(s, len);
+    return se;
+}
+
+struct StringSlot
+{
+    hash_t hash;
+    StringEntry *entry;         // NULL if the slot is free
+};
+
 void StringTable::init(size_t size)
 {
-    table = (void **)mem.calloc(size, sizeof(void *));
-    tabledim = size;
+    tabledim = 16;
+    while (tabledim < size)
+        tabledim *= 2;
+    table = (StringSlot *)mem.calloc(tabledim, sizeof(StringSlot));
     count = 0;
 }
 
@@ -73,72 +93,79 @@ StringTable::~StringTable()
 {
     // Zero out dangling pointers to help garbage collector.
     // Should zero out StringEntry's too.
-    for (size_t i = 0; i < count; i++)
-        table[i] = NULL;
+    for (size_t i = 0; i < tabledim; i++)
+        table[i].entry = NULL;
 
     mem.free(table);
     table = NULL;
 }
 
-struct StringEntry
+/*************************************
+ * Return the slot holding s, or the free slot where it would go.
+ */
+
+size_t StringTable::search(const char *s, size_t len, hash_t hash)
 {
-    StringEntry *left;
-    StringEntry *right;
-    hash_t hash;
+    size_t mask = tabledim - 1;
 
-    StringValue value;
+    //printf("StringTable::search(%p,%d)\n",s,len);
+    for (size_t i = hash & mask; ; i = (i + 1) & mask)
+    {
+        StringSlot *slot = &table[i];
+        if (!slot->entry)
+            return i;
+        if (slot->hash == hash &&
+            slot->entry->value.len() == len &&
+            ::memcmp(s, slot->entry->value.toDchars(), len) == 0)
+            return i;
+    }
+}
 
-    static StringEntry *alloc(const char *s, size_t len);
-};
+/*************************************
+ * Double the number of slots, keeping the table at most half full.
+ */
 
-StringEntry *StringEntry::alloc(const char *s, size_t len)
+void StringTable::grow()
 {
-    StringEntry *se;
+    StringSlot *oldtable = table;
+    size_t olddim = tabledim;
 
-    se = (StringEntry *) mem.calloc(1,sizeof(StringEntry) + len + 1);
-    se->value.ctor(s, len);
-    se->hash = calcHash(s,len);
-    return se;
+    tabledim *= 2;
+    table = (StringSlot *)mem.calloc(tabledim, sizeof(StringSlot));
+
+    size_t mask = tabledim - 1;
+    for (size_t j = 0; j < olddim; j++)
+    {
+        if (!oldtable[j].entry)
+            continue;
+        size_t i = oldtable[j].hash & mask;
+        while (table[i].entry)
+            i = (i + 1) & mask;
+        table[i] = oldtable[j];
+    }
+    mem.free(oldtable);
 }
 
-void **StringTable::search(const char *s, size_t len)
-{
-    hash_t hash;
-    unsigned u;
-    int cmp;
-    StringEntry **se;
+/*************************************
+ * Create an entry for s in free slot i.
+ */
 
-    //printf("StringTable::search(%p,%d)\n",s,len);
-    hash = calcHash(s,len);
-    u = hash % tabledim;
-    se = (StringEntry **)&table[u];
-    //printf("\thash = %d, u = %d\n",hash,u);
-    while (*se)
+StringValue *StringTable::add(size_t i, const char *s, size_t len, hash_t hash)
+{
+    if ((count + 1) * 2 > tabledim)
     {
-        cmp = (*se)->hash - hash;
-        if (cmp == 0)
-        {
-            cmp = (*se)->value.len() - len;
-            if (cmp == 0)
-            {
-                cmp = ::memcmp(s,(*se)->value.toDchars(),len);
-                if (cmp == 0)
-                    break;
-            }
-        }
-        if (cmp < 0)
-            se = &(*se)->left;
-        else
-            se = &(*se)->right;
+        grow();
+        i = search(s, len, hash);
     }
-    //printf("\treturn %p, %p\n",se, (*se));
-    return (void **)se;
+    count++;
+    table[i].hash = hash;
+    table[i].entry = StringEntry::alloc(s, len);
+    return &table[i].entry->value;
 }
 
 StringValue *StringTable::lookup(const char *s, size_t len)
-{   StringEntry *se;
-
-    se = *(StringEntry **)search(s,len);
+{
+    StringEntry *se = table[search(s, len, calcHash(s, len))].entry;
     if (se)
         return &se->value;
     else
@@ -146,31 +173,100 @@ StringValue *StringTable::lookup(const char *s, size_t len)
 }
 
 StringValue *StringTable::update(const char *s, size_t len)
-{   StringEntry **pse;
-    StringEntry *se;
-
-    pse = (StringEntry **)search(s,len);
-    se = *pse;
+{
+    hash_t hash = calcHash(s, len);
+    size_t i = search(s, len, hash);
+    StringEntry *se = table[i].entry;
     if (!se)                    // not in table: so create new entry
-    {
-        se = StringEntry::alloc(s, len);
-        *pse = se;
-    }
+        return add(i, s, len, hash);
     return &se->value;
 }
 
 StringValue *StringTable::insert(const char *s, size_t len)
-{   StringEntry **pse;
-    StringEntry *se;
-
-    pse = (StringEntry **)search(s,len);
-    se = *pse;
-    if (se)
+{
+    hash_t hash = calcHash(s, len);
+    size_t i = search(s, len, hash);
+    if (table[i].entry)
         return NULL;            // error: already in table
-    else
+    return add(i, s, len, hash);
+}
+
+#if UNITTEST
+
+#include <assert.h>
+
+void unittest_stringtable()
+{
+    StringTable st;
+    char buf[16];
+    char keys[8][16];
+    const char *colliding[8];
+
+    // Keys that all start in the same slot of the initial table, so each
+    // has to probe past the others.
+    st.init(1);
+    size_t ncolliding = 0;
+    hash_t first = 0;
+    for (size_t i = 0; ncolliding < 8; i++)
     {
-        se = StringEntry::alloc(s, len);
-        *pse = se;
+        sprintf(keys[ncolliding], "k%u", (unsigned)i);
+        hash_t hash = calcHash(keys[ncolliding], strlen(keys[ncolliding]));
+        if (ncolliding == 0)
+            first = hash;
+        else if ((hash & 15) != (first & 15))
+            continue;
+        colliding[ncolliding] = keys[ncolliding];
+        ncolliding++;
     }
-    return &se->value;
+    // The last one is left out, to be looked up missing at the end of
+    // the chain.
+    for (size_t i = 0; i < 7; i++)
+    {
+        StringValue *sv = st.insert(colliding[i], strlen(colliding[i]));
+        assert(sv);
+        sv->ptrvalue = (void *)colliding[i];
+    }
+    for (size_t i = 0; i < 7; i++)
+    {
+        StringValue *sv = st.lookup(colliding[i], strlen(colliding[i]));
+        assert(sv && sv->ptrvalue == colliding[i]);
+        assert(strcmp(sv->toDchars(), colliding[i]) == 0);
+        assert(!st.insert(colliding[i], strlen(colliding[i])));
+        assert(st.update(colliding[i], strlen(colliding[i])) == sv);
+    }
+    assert(!st.lookup(colliding[7], strlen(colliding[7])));
+
+    // Prefixes and extensions of a key are different keys.
+    assert(!st.lookup(colliding[0], strlen(colliding[0]) - 1));
+    assert(!st.lookup("", 0));
+
+    // Grow the table many times over, checking that entries keep their
+    // values and addresses as it does.
+    StringValue *sv0 = st.lookup(colliding[0], strlen(colliding[0]));
+    const size_t count = 5000;
+    for (size_t i = 0; i < count; i++)
+    {
+        sprintf(buf, "id%u", (unsigned)i);
+        StringValue *sv = st.update(buf, strlen(buf));
+        assert(sv && !sv->ptrvalue);
+        sv->ptrvalue = (void *)(i + 1);
+        assert(st.lookup(buf, strlen(buf)) == sv);
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        sprintf(buf, "id%u", (unsigned)i);
+        StringValue *sv = st.lookup(buf, strlen(buf));
+        assert(sv && sv->ptrvalue == (void *)(i + 1));
+        assert(sv->len() == strlen(buf));
+        assert(!st.insert(buf, strlen(buf)));
+    }
+    for (size_t i = count; i < 2 * count; i++)
+    {
+        sprintf(buf, "id%u", (unsigned)i);
+        assert(!st.lookup(buf, strlen(buf)));
+    }
+    assert(st.lookup(colliding[0], strlen(colliding[0])) == sv0);
+    assert(!st.lookup(colliding[7], strlen(colliding[7])));
 }
+
+#endif
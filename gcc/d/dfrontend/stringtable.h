@@ -18,6 +18,7 @@
 #include "root.h"
 
 struct StringEntry;
+struct StringSlot;
 
 // StringValue is a variable-length structure as indicated by the last array
 // member with unspecified size.  It has neither proper c'tors nor a factory
@@ -49,12 +50,14 @@ private:
     void ctor(const char *p, size_t length);
 };
 
+// Open addressed, growing as entries are added; the size given to init()
+// is only where it starts.
 struct StringTable
 {
 private:
-    void **table;
+    StringSlot *table;
     size_t count;
-    size_t tabledim;
+    size_t tabledim;            // a power of 2
 
 public:
     void init(size_t size = 37);
@@ -65,7 +68,9 @@ public:
     StringValue *update(const char *s, size_t len);
 
 private:
-    void **search(const char *s, size_t len);
+    size_t search(const char *s, size_t len, hash_t hash);
+    StringValue *add(size_t i, const char *s, size_t len, hash_t hash);
+    void grow();
 };
 
 #endif
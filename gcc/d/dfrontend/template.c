@@ -319,6 +319,156 @@ int arrayObjectMatch(Objects *oa1, Objects *oa2, TemplateDeclaration *tempdecl,
     return 1;
 }
 
+/****************************************
+ * Compute a hash of o that is consistent with match():
+ * types are hashed by their merged deco, expressions by value,
+ * and symbols by identifier and parent.
+ * Returns 0 if o cannot be hashed.
+ */
+
+static hash_t expressionHash(Expression *e)
+{
+    hash_t h = e->op;
+    switch (e->op)
+    {
+        case TOKint64:
+            h = h * 37 + (hash_t)((IntegerExp *)e)->value;
+            break;
+
+        case TOKstring:
+        {   // StringExp::compare() only looks at the first len code units,
+            // so the first len bytes are equal whenever the strings are.
+            StringExp *se = (StringExp *)e;
+            h = h * 37 + se->len;
+            h = h * 37 + String::calcHash((const char *)se->string, se->len);
+            break;
+        }
+
+        case TOKvar:
+            h = h * 37 + (hash_t)((VarExp *)e)->var;
+            break;
+
+        case TOKtuple:
+        {   Expressions *exps = ((TupleExp *)e)->exps;
+            for (size_t i = 0; i < exps->dim; i++)
+                h = h * 37 + expressionHash((*exps)[i]);
+            break;
+        }
+
+        default:
+            break;
+    }
+    return h;
+}
+
+static hash_t objectHash(Object *o)
+{
+    if (!o)
+        return 0;               // match() treats NULL as a wildcard
+
+    Type *t = isType(o);
+    Dsymbol *s = isDsymbol(o);
+    Expression *e = s ? getValue(s) : getValue(isExpression(o));
+    Tuple *u = isTuple(o);
+
+    if (t)
+    {
+        if (t->ty == Ttuple)
+        {   // TypeTuple::equals() compares the element types only
+            Parameters *args = ((TypeTuple *)t)->arguments;
+            hash_t h = 1;
+            for (size_t i = 0; i < args->dim; i++)
+            {   hash_t h1 = objectHash((*args)[i]->type);
+                if (!h1)
+                    return 0;
+                h = h * 37 + h1;
+            }
+            return h;
+        }
+        // deco strings are unique, but an unmerged type may be merged
+        // later and then start to equal other types
+        return (hash_t)t->deco;
+    }
+    else if (e)
+        return expressionHash(e) * 37 + 2;
+    else if (s)
+    {
+        hash_t h = s->ident ? s->ident->hashCode() : (hash_t)s;
+        return h * 37 + (hash_t)s->parent + 3;
+    }
+    else if (u)
+    {
+        hash_t h = 4;
+        for (size_t i = 0; i < u->objects.dim; i++)
+        {   hash_t h1 = objectHash(u->objects[i]);
+            if (!h1)
+                return 0;
+            h = h * 37 + h1;
+        }
+        return h;
+    }
+    return 0;
+}
+
+/****************************************
+ * Hash an array of template arguments, so that arrays that
+ * arrayObjectMatch() would accept have the same hash.
+ * Returns 0 if the array cannot be hashed.
+ * Instances whose tdtypes cannot be hashed are kept
+ * in TemplateDeclaration::buckets under hash 0.
+ */
+
+hash_t arrayObjectHash(Objects *oa)
+{
+    hash_t h = oa->dim;
+    for (size_t j = 0; j < oa->dim; j++)
+    {   hash_t h1 = objectHash((*oa)[j]);
+        if (!h1)
+            return 0;
+        h = h * 37 + h1;
+    }
+    // Mix the high bits down, the result is used modulo the bucket count.
+    h ^= h >> 17;
+    h *= 0x9E3779B1;
+    h ^= h >> 13;
+    return h ? h : 1;
+}
+
+/****************************************
+ * Return 1 if a type in oa would be diagnosed by match() as a
+ * recursive expansion of tempdecl from within scope sc.
+ */
+
+static int arrayObjectIsRecursive(Objects *oa, TemplateDeclaration *tempdecl, Scope *sc)
+{
+    for (size_t j = 0; j < oa->dim; j++)
+    {   Object *o = (*oa)[j];
+        Tuple *u = isTuple(o);
+        if (u)
+        {
+            if (arrayObjectIsRecursive(&u->objects, tempdecl, sc))
+                return 1;
+            continue;
+        }
+        Type *t = isType(o);
+        if (!t)
+            continue;
+        Dsymbol *s = t->toDsymbol(sc);
+        if (s && s->parent)
+        {   TemplateInstance *ti1 = s->parent->isTemplateInstance();
+            if (ti1 && ti1->tempdecl == tempdecl)
+            {
+                for (Scope *sc1 = sc; sc1; sc1 = sc1->enclosing)
+                {
+                    if (sc1->scopesym == ti1)
+                        return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
 /****************************************
  * This makes a 'pretty' version of the template arguments.
  * It's analogous to genIdent() which makes a mangled version.
@@ -393,6 +543,8 @@ Object *objectSyntaxCopy(Object *o)
 
 /* ======================== TemplateDeclaration ============================= */
 
+Dsymbols TemplateDeclaration::instantiated;
+
 TemplateDeclaration::TemplateDeclaration(Loc loc, Identifier *id,
         TemplateParameters *parameters, Expression *constraint, Dsymbols *decldefs, int ismixin)
     : ScopeDsymbol(id)
@@ -425,6 +577,8 @@ TemplateDeclaration::TemplateDeclaration(Loc loc, Identifier *id,
     this->literal = 0;
     this->ismixin = ismixin;
     this->previous = NULL;
+    this->buckets = NULL;
+    this->numinstances = 0;
 
     // Compute in advance for Ddoc's use
     if (members)
@@ -483,6 +637,12 @@ void TemplateDeclaration::semantic(Scope *sc)
             Type::rtinfo = this;
     }
 
+    /* Instances in other modules may derive from private classes of
+     * this one, see ClassDeclaration::isHierarchyClosed().
+     */
+    if (sc->module)
+        sc->module->hastemplates = 1;
+
     if (sc->func)
     {
 #if DMDV1
@@ -4638,7 +4798,9 @@ TemplateInstance::TemplateInstance(Loc loc, Identifier *ident)
 #endif
     this->havetempdecl = 0;
     this->isnested = NULL;
+    this->mangled = NULL;
     this->speculative = 0;
+    this->hash = 0;
 }
 
 /*****************
@@ -4669,7 +4831,9 @@ TemplateInstance::TemplateInstance(Loc loc, TemplateDeclaration *td, Objects *ti
 #endif
     this->havetempdecl = 1;
     this->isnested = NULL;
+    this->mangled = NULL;
     this->speculative = 0;
+    this->hash = 0;
 
     assert((size_t)tempdecl->scope > 0x10000);
 }
@@ -4890,11 +5054,25 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
 
     /* See if there is an existing TemplateInstantiation that already
      * implements the typeargs. If so, just refer to that one instead.
+     * Only the instances with the same hash, and those that could not be
+     * hashed, need to be checked, unless match() has to see every instance
+     * to diagnose a recursive expansion.
      */
+    hash = arrayObjectHash(&tdtypes);
 
-    for (size_t i = 0; i < tempdecl->instances.dim; i++)
+    TemplateInstances *tinstances = &tempdecl->instances;
+    TemplateInstances *tunhashed = NULL;
+    if (hash && !arrayObjectIsRecursive(&tdtypes, tempdecl, sc))
     {
-        TemplateInstance *ti = tempdecl->instances[i];
+        tinstances = (TemplateInstances *)_aaGetRvalue(tempdecl->buckets, (void *)hash);
+        tunhashed = (TemplateInstances *)_aaGetRvalue(tempdecl->buckets, NULL);
+    }
+    size_t ninstances = tinstances ? tinstances->dim : 0;
+    size_t nunhashed = tunhashed ? tunhashed->dim : 0;
+
+    for (size_t i = 0; i < ninstances + nunhashed; i++)
+    {
+        TemplateInstance *ti = i < ninstances ? (*tinstances)[i] : (*tunhashed)[i - ninstances];
 #if LOG
         printf("\t%s: checking for match with instance %d (%p): '%s'\n", toChars(), i, ti, ti->toChars());
 #endif
@@ -4986,6 +5164,14 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
 
     size_t tempdecl_instance_idx = tempdecl->instances.dim;
     tempdecl->instances.push(this);
+    if (!tempdecl->numinstances++)
+        TemplateDeclaration::instantiated.push(tempdecl);
+    {
+        TemplateInstances **pb = (TemplateInstances **)_aaGet(&tempdecl->buckets, (void *)hash);
+        if (!*pb)
+            *pb = new TemplateInstances();
+        (*pb)->push(this);
+    }
     parent = tempdecl->parent;
     //printf("parent = '%s'\n", parent->kind());
 
@@ -5269,6 +5455,14 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
             // finish clean and so we can try to instantiate it again later
             // (see bugzilla 4302 and 6602).
             tempdecl->instances.remove(tempdecl_instance_idx);
+            TemplateInstances *b = (TemplateInstances *)_aaGetRvalue(tempdecl->buckets, (void *)hash);
+            for (size_t i = b->dim; i--; )
+            {
+                if ((*b)[i] == this)
+                {   b->remove(i);
+                    break;
+                }
+            }
             if (target_symbol_list)
             {
                 // Because we added 'this' in the last position above, we
@@ -5278,6 +5472,7 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
             }
             semanticRun = PASSinit;
             inst = NULL;
+            mangled = NULL;
         }
     }
 
@@ -55,6 +55,10 @@ struct TemplateDeclaration : ScopeDsymbol
     TemplateParameters *origParameters; // originals for Ddoc
     Expression *constraint;
     TemplateInstances instances;        // array of TemplateInstance's
+    AA *buckets;                        // TemplateInstances* of instances[],
+                                        // keyed by arrayObjectHash(tdtypes)
+    ulonglong numinstances;             // number of instances ever created
+    static Dsymbols instantiated;       // TemplateDeclaration's with numinstances != 0
 
     TemplateDeclaration *overnext;      // next overloaded TemplateDeclaration
     TemplateDeclaration *overroot;      // first in overnext list
@@ -298,6 +302,8 @@ struct TemplateInstance : ScopeDsymbol
     int havetempdecl;   // 1 if used second constructor
     Dsymbol *isnested;  // if referencing local symbols, this is the context
     int speculative;    // 1 if only instantiated with errors gagged
+    hash_t hash;        // arrayObjectHash(&tdtypes), 0 if not hashable
+    char *mangled;      // mangle(), once it cannot change
 #ifdef IN_GCC
     /* On some targets, it is necessary to know whether a symbol
        will be emitted in the output or not before the symbol
@@ -372,6 +378,7 @@ Type *isType(Object *o);
 Tuple *isTuple(Object *o);
 Parameter *isParameter(Object *o);
 int arrayObjectIsError(Objects *args);
+hash_t arrayObjectHash(Objects *oa);
 int isError(Object *o);
 Type *getType(Object *o);
 Dsymbol *getDsymbol(Object *o);
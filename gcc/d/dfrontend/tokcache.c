@@ -0,0 +1,445 @@
+// Compiler implementation of the D programming language
+// Copyright (c) 2013 by Digital Mars
+// All Rights Reserved
+// http://www.digitalmars.com
+// License for redistribution is by either the Artistic License
+// in artistic.txt, or the GNU General Public License in gnu.txt.
+// See the included readme.txt for details.
+
+#define POSIX (linux || __APPLE__ || __FreeBSD__ || __OpenBSD__ || __sun)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>                     // offsetof
+#include <assert.h>
+#include <string.h>
+
+#if POSIX
+#include <unistd.h>
+#endif
+
+#include "rmem.h"
+#include "root.h"
+
+#include "mars.h"
+#include "lexer.h"
+#include "identifier.h"
+
+/* Every compile of a module scans all the modules it imports again, and
+ * for the larger library modules that is a good part of the work.
+ * When a cache directory is given, the tokens of a source are written to
+ * a file named after a hash of its text the first time it is scanned.
+ * Later compiles map that file and hand its tokens to the parser instead
+ * of scanning the source again.
+ *
+ * Only the scan is saved: the parser still runs on the replayed tokens,
+ * as there is no way to write out and read back the AST it builds.
+ *
+ * The file holds a copy of the source, and is only used if that is the
+ * same as the text being compiled, so a hash collision is a cache miss.
+ * So is a file which has been truncated or is otherwise not well formed;
+ * it is checked in full before any token of it is replayed.
+ *
+ * Everything the parser takes from a token is stored, including the line
+ * numbers, so error messages come out the same. A source is not cached if
+ * its tokens depend on more than its text: if it uses __DATE__, __TIME__
+ * or __TIMESTAMP__, changes the file name with #line, or gets an error or
+ * deprecation message while being parsed.
+ */
+
+#define LOG     0
+
+#define TOKCACHE_VERSION        2
+
+const char *TokenCache::dir;
+
+enum TokKind
+{
+    TKnone,
+    TKident,                    // Token::ident
+    TKint,                      // Token::uns64value
+    TKfloat,                    // Token::float80value
+    TKstring,                   // Token::ustring, len and postfix
+};
+
+static unsigned char tokkind[TOKMAX];
+
+static void initTokKinds()
+{
+    if (tokkind[TOKidentifier])
+        return;
+
+    // Keywords are scanned as identifiers, and keep theirs
+    for (int i = 0; i < TOKMAX; i++)
+    {   Token t;
+        t.value = (enum TOK)i;
+        if (t.isKeyword())
+            tokkind[i] = TKident;
+    }
+    tokkind[TOKidentifier] = TKident;
+
+    tokkind[TOKint32v] = TKint;
+    tokkind[TOKuns32v] = TKint;
+    tokkind[TOKint64v] = TKint;
+    tokkind[TOKuns64v] = TKint;
+    tokkind[TOKcharv] = TKint;
+    tokkind[TOKwcharv] = TKint;
+    tokkind[TOKdcharv] = TKint;
+
+    tokkind[TOKfloat32v] = TKfloat;
+    tokkind[TOKfloat64v] = TKfloat;
+    tokkind[TOKfloat80v] = TKfloat;
+    tokkind[TOKimaginary32v] = TKfloat;
+    tokkind[TOKimaginary64v] = TKfloat;
+    tokkind[TOKimaginary80v] = TKfloat;
+
+    tokkind[TOKstring] = TKstring;
+}
+
+/* Start of a cache file. Everything up to datalen must match for the file
+ * to be used. It is followed by the source text, then the tokens.
+ */
+
+struct TokenCacheHeader
+{
+    char magic[4];              // "DTOK"
+    unsigned version;           // TOKCACHE_VERSION
+    unsigned tokmax;            // TOKMAX
+    unsigned realsize;          // sizeof(Token::float80value)
+    unsigned dversion;          // global.params.Dversion
+    char compiler[60];          // global.version and build date
+    unsigned long long srclen;
+    unsigned long long srchash;
+    unsigned long long datalen; // size of the source and tokens following the header
+};
+
+#define KEYSIZE offsetof(TokenCacheHeader, datalen)
+
+/*************************************
+ * FNV-1a hash of the source text.
+ */
+
+static unsigned long long hashSource(unsigned char *buf, size_t buflen)
+{
+    unsigned long long h = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < buflen; i++)
+    {
+        h ^= buf[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/*************************************
+ * Number of line breaks in [p, pend), counted the way Lexer::tokenLoc()
+ * counts them.
+ */
+
+static unsigned countLines(unsigned char *p, unsigned char *pend)
+{
+    unsigned n = 0;
+
+    for (; p < pend; p++)
+    {
+        if (*p == '\n' || (*p == '\r' && p[1] != '\n'))
+            n++;
+    }
+    return n;
+}
+
+/*************************************
+ * Check that [p, end) holds whole tokens as written by TokenCache::scan(),
+ * the last of which is the end of file.
+ */
+
+static int checkTokens(unsigned char *p, unsigned char *end)
+{
+    while (1)
+    {
+        unsigned short value;
+        unsigned len;
+
+        if (end - p < (ptrdiff_t)(sizeof(value) + 2 * sizeof(unsigned)))
+            return 0;
+        memcpy(&value, p, sizeof(value));
+        if (value >= TOKMAX)
+            return 0;
+        p += sizeof(value) + 2 * sizeof(unsigned);
+
+        switch (tokkind[value])
+        {
+            case TKident:
+                if (end - p < (ptrdiff_t)sizeof(len))
+                    return 0;
+                memcpy(&len, p, sizeof(len));
+                p += sizeof(len);
+                if ((size_t)(end - p) <= len || p[len] != 0)
+                    return 0;
+                p += len + 1;
+                break;
+
+            case TKint:
+                p += sizeof(((Token *)NULL)->uns64value);
+                break;
+
+            case TKfloat:
+                p += sizeof(((Token *)NULL)->float80value);
+                break;
+
+            case TKstring:
+                if (end - p < (ptrdiff_t)sizeof(len))
+                    return 0;
+                memcpy(&len, p, sizeof(len));
+                p += sizeof(len);
+                if ((size_t)(end - p) <= len)
+                    return 0;
+                p += 1 + len;
+                break;
+
+            default:
+                break;
+        }
+        if (p > end)
+            return 0;
+        if (value == TOKeof)
+            return p == end;
+    }
+}
+
+TokenCache::TokenCache()
+{
+    lexer = NULL;
+    file = NULL;
+    record = NULL;
+    p = NULL;
+    end = NULL;
+    filename = NULL;
+    errors = 0;
+    failed = 0;
+}
+
+/*************************************
+ * Start supplying the tokens of source buf[0 .. buflen] to lexer.
+ * Returns:
+ *      !=0 if the tokens are replayed from or recorded to the cache
+ *      0   if there is no cache
+ */
+
+int TokenCache::open(Lexer *lexer, unsigned char *buf, size_t buflen)
+{
+    if (!dir || lexer->doDocComment)
+        return 0;
+
+    initTokKinds();
+    this->lexer = lexer;
+    filename = lexer->loc.filename;
+
+    TokenCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "DTOK", 4);
+    h.version = TOKCACHE_VERSION;
+    h.tokmax = TOKMAX;
+    h.realsize = sizeof(((Token *)NULL)->float80value);
+    h.dversion = global.params.Dversion;
+    snprintf(h.compiler, sizeof(h.compiler), "%s %s %s", global.version, __DATE__, __TIME__);
+    h.srclen = buflen;
+    h.srchash = hashSource(buf, buflen);
+
+    char name[sizeof(h.srchash) * 2 + 5];
+    sprintf(name, "%016llx.tok", h.srchash);
+    file = new File(FileName::combine(dir, name));
+
+    if (file->mmread() == 0 && file->len >= sizeof(h) + buflen &&
+        memcmp(file->buffer, &h, KEYSIZE) == 0)
+    {
+        TokenCacheHeader *fh = (TokenCacheHeader *)file->buffer;
+        unsigned char *src = file->buffer + sizeof(h);
+        if (fh->datalen == file->len - sizeof(h) &&
+            memcmp(src, buf, buflen) == 0 &&
+            checkTokens(src + buflen, file->buffer + file->len))
+        {
+#if LOG
+            printf("TokenCache::open('%s') replay %s\n", filename, file->toChars());
+#endif
+            p = src + buflen;
+            end = file->buffer + file->len;
+            return 1;
+        }
+    }
+    file->freeData();
+
+#if LOG
+    printf("TokenCache::open('%s') record %s\n", filename, file->toChars());
+#endif
+    record = new OutBuffer();
+    record->write(&h, sizeof(h));
+    record->write(buf, buflen);
+    errors = global.errors;
+    return 1;
+}
+
+/*************************************
+ * Get the next token, like Lexer::scan().
+ */
+
+void TokenCache::scan(Token *t)
+{
+    if (!record)
+    {
+        replay(t);
+        return;
+    }
+
+    lexer->scan(t);
+    if (failed)
+        return;
+
+    /* __DATE__, __TIME__ and __TIMESTAMP__ are scanned as strings; they
+     * are the only ones starting with '_'.
+     */
+    if ((t->value == TOKstring && *t->ptr == '_') || lexer->loc.filename != filename)
+    {   failed = 1;
+        return;
+    }
+
+    unsigned short value = t->value;
+    unsigned endline = lexer->loc.linnum;
+    unsigned startline = endline - countLines(t->ptr, lexer->p);
+
+    record->write(&value, sizeof(value));
+    record->write(&startline, sizeof(startline));
+    record->write(&endline, sizeof(endline));
+    switch (tokkind[value])
+    {
+        case TKident:
+        {   unsigned len = (unsigned)t->ident->len;
+            record->write(&len, sizeof(len));
+            record->write(t->ident->string, len + 1);
+            break;
+        }
+
+        case TKint:
+            record->write(&t->uns64value, sizeof(t->uns64value));
+            break;
+
+        case TKfloat:
+            record->write(&t->float80value, sizeof(t->float80value));
+            break;
+
+        case TKstring:
+            record->write(&t->len, sizeof(t->len));
+            record->writeByte(t->postfix);
+            record->write(t->ustring, t->len);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*************************************
+ * Fill in t from the next token of the cache file, which open() has
+ * checked.
+ */
+
+void TokenCache::replay(Token *t)
+{
+    unsigned char *q = p;
+    unsigned short value;
+    unsigned startline;
+    unsigned endline;
+
+    assert(q < end);
+    memcpy(&value, q, sizeof(value));
+    q += sizeof(value);
+    memcpy(&startline, q, sizeof(startline));
+    q += sizeof(startline);
+    memcpy(&endline, q, sizeof(endline));
+    q += sizeof(endline);
+
+    t->ptr = NULL;
+    t->blockComment = NULL;
+    t->lineComment = NULL;
+    t->value = (enum TOK)value;
+    t->linnum = startline;
+    lexer->loc.linnum = endline;
+
+    switch (tokkind[value])
+    {
+        case TKident:
+        {   unsigned len;
+            memcpy(&len, q, sizeof(len));
+            q += sizeof(len);
+            t->ident = Lexer::idPool((char *)q);
+            q += len + 1;
+            break;
+        }
+
+        case TKint:
+            memcpy(&t->uns64value, q, sizeof(t->uns64value));
+            q += sizeof(t->uns64value);
+            break;
+
+        case TKfloat:
+            memcpy((void *)&t->float80value, q, sizeof(t->float80value));
+            q += sizeof(t->float80value);
+            break;
+
+        case TKstring:
+        {   unsigned len;
+            memcpy(&len, q, sizeof(len));
+            q += sizeof(len);
+            t->postfix = *q++;
+            // The AST keeps the string, so it cannot point into the file
+            t->ustring = (unsigned char *)mem.malloc(len + 1);
+            memcpy(t->ustring, q, len);
+            t->ustring[len] = 0;
+            t->len = len;
+            q += len;
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    // Like the scanner, keep returning the end of file
+    if (t->value != TOKeof)
+        p = q;
+}
+
+/*************************************
+ * Done with the source. Write the cache file if it was recorded
+ * without trouble.
+ */
+
+void TokenCache::close()
+{
+    if (record && !failed && global.errors == errors)
+    {
+        TokenCacheHeader *h = (TokenCacheHeader *)record->data;
+        h->datalen = record->offset - sizeof(TokenCacheHeader);
+
+        /* Write to a temporary and rename it, so a compile running
+         * at the same time never maps half a file.
+         */
+        OutBuffer tmpname;
+#if POSIX
+        tmpname.printf("%s.%d", file->toChars(), (int)getpid());
+#else
+        tmpname.printf("%s.tmp", file->toChars());
+#endif
+        tmpname.writeByte(0);
+        File f((char *)tmpname.data);
+        f.setbuffer(record->data, record->offset);
+        f.ref = 1;
+        if (f.write() || rename((char *)tmpname.data, file->toChars()))
+            remove((char *)tmpname.data);
+    }
+    delete record;
+    record = NULL;
+    file->freeData();
+    delete file;
+    file = NULL;
+}
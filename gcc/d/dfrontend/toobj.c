@@ -381,8 +381,8 @@ void ClassDeclaration::toObjFile(int multiobj)
         return;
     }
 
-    if (global.params.symdebug)
-        toDebug();
+    // Also gives the optimizer the vtbl, so is not only for symdebug
+    toDebug();
 
     assert(!scope);     // semantic() should have been run to completion
 
@@ -14,6 +14,8 @@
 void unittest_speller();
 void unittest_importHint();
 void unittest_aa();
+void unittest_dircache();
+void unittest_stringtable();
 
 void unittests()
 {
@@ -21,5 +23,7 @@ void unittests()
     unittest_speller();
     unittest_importHint();
     unittest_aa();
+    unittest_dircache();
+    unittest_stringtable();
 #endif
 }